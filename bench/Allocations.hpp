@@ -0,0 +1,9 @@
+#ifndef ALLOCATIONS_HPP
+#define ALLOCATIONS_HPP
+#include <cstdint>
+
+// Number of calls to operator new so far, by any thread. The operator is
+// replaced for the whole benchmark binary to count them.
+uint64_t AllocationCount();
+
+#endif
@@ -0,0 +1,58 @@
+#include "BenchDatabase.hpp"
+#include "BenchModules.hpp"
+
+#include <stdexcept>
+
+BenchDatabase::BenchDatabase() {
+  // Every connection opened from now on gets the extension
+  static int registered =
+   sqlite3_auto_extension((void (*)(void))bench_extension_init);
+  if (registered != SQLITE_OK ||
+      sqlite3_open(":memory:", &m_db) != SQLITE_OK) {
+    throw std::runtime_error("Cannot open the benchmark database");
+  }
+}
+
+BenchDatabase::~BenchDatabase() { sqlite3_close(m_db); }
+
+void BenchDatabase::Exec(const std::string &sql) {
+  char *err = nullptr;
+  if (sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+    std::string msg = err ? err : sqlite3_errmsg(m_db);
+    sqlite3_free(err);
+    throw std::runtime_error(msg);
+  }
+}
+
+size_t BenchDatabase::Run(const std::string &sql) {
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(m_db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    throw std::runtime_error(sqlite3_errmsg(m_db));
+  }
+
+  size_t rows = 0;
+  int rc;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    rows++;
+  }
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_DONE) {
+    throw std::runtime_error(sqlite3_errmsg(m_db));
+  }
+  return rows;
+}
+
+sqlite3_int64 BenchDatabase::Scalar(const std::string &sql) {
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(m_db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    throw std::runtime_error(sqlite3_errmsg(m_db));
+  }
+
+  int rc = sqlite3_step(stmt);
+  sqlite3_int64 res = rc == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+    throw std::runtime_error(sqlite3_errmsg(m_db));
+  }
+  return res;
+}
@@ -0,0 +1,26 @@
+#ifndef BENCHDATABASE_HPP
+#define BENCHDATABASE_HPP
+#include "sqlite3.h"
+
+#include <cstddef>
+#include <string>
+
+// In-memory database with the clangql extension and the benchmark modules
+// loaded. Throws std::runtime_error when a statement fails.
+class BenchDatabase {
+  sqlite3 *m_db = nullptr;
+
+public:
+  BenchDatabase();
+  ~BenchDatabase();
+  BenchDatabase(const BenchDatabase &) = delete;
+  BenchDatabase &operator=(const BenchDatabase &) = delete;
+
+  void Exec(const std::string &sql);
+  // Steps through every row of `sql`, returning their number
+  size_t Run(const std::string &sql);
+  // Returns the first column of the first row of `sql`, as an integer
+  sqlite3_int64 Scalar(const std::string &sql);
+};
+
+#endif
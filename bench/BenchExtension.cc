@@ -0,0 +1,19 @@
+#include "sqlite3ext.h"
+SQLITE_EXTENSION_INIT3
+
+#include "BenchModules.hpp"
+#include "TextsModule.hpp"
+
+extern "C" int sqlite3_clangql_init(sqlite3 *db, char **pzErrMsg,
+                                    const sqlite3_api_routines *pApi);
+
+// Registering the extension first sets up the API pointer used by the
+// benchmark modules
+extern "C" int bench_extension_init(sqlite3 *db, char **pzErrMsg,
+                                    const sqlite3_api_routines *pApi) {
+  int rc = sqlite3_clangql_init(db, pzErrMsg, pApi);
+  if (rc != SQLITE_OK) {
+    return rc;
+  }
+  return (new TextsModule())->Register(db, "bench_texts");
+}
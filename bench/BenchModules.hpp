@@ -0,0 +1,12 @@
+#ifndef BENCHMODULES_HPP
+#define BENCHMODULES_HPP
+#include "sqlite3.h"
+
+#include <cstddef>
+
+// Loads the clangql extension into `db`, along with the virtual table modules
+// that only exist for benchmarks
+extern "C" int bench_extension_init(sqlite3 *db, char **pzErrMsg,
+                                    const sqlite3_api_routines *pApi);
+
+#endif
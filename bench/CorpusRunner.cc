@@ -0,0 +1,395 @@
+// Runs the queries of a corpus file through the clangql extension, loaded
+// from the shared library that was built, against a fake index server.
+// Reports the time, RPCs, bytes and rows of each query, and fails if any of
+// them goes over its budget, or if the query isn't planned as expected:
+//
+//   clangql_corpus path/to/libclangql.so bench/corpus.sql
+#include "FakeIndex.hpp"
+#include "IndexGenerator.hpp"
+#include "sqlite3.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace clang::clangd::remote;
+
+struct CorpusQuery {
+  std::string name;
+  std::string sql;
+  // Budgets, or -1 if the query has none
+  int64_t rpcs = -1;
+  int64_t bytes = -1;
+  int64_t rows = -1;
+  // Expected start of each line of EXPLAIN QUERY PLAN, or empty if the plan
+  // is not checked
+  std::vector<std::string> plan;
+};
+
+struct QueryResult {
+  double millis;
+  uint64_t rpcs;
+  uint64_t bytes;
+  uint64_t rows;
+};
+
+static bool starts_with(const std::string &text, const char *prefix) {
+  return text.compare(0, std::char_traits<char>::length(prefix), prefix) == 0;
+}
+
+static void read_budget(const std::string &line, CorpusQuery &query) {
+  std::istringstream pairs(line.substr(std::strlen("-- budget:")));
+  std::string pair;
+  while (pairs >> pair) {
+    auto eq = pair.find('=');
+    if (eq == std::string::npos) {
+      throw std::runtime_error("Invalid budget `" + pair + "'");
+    }
+    auto key = pair.substr(0, eq);
+    auto value = std::stoll(pair.substr(eq + 1));
+    if (key == "rpcs") {
+      query.rpcs = value;
+    } else if (key == "bytes") {
+      query.bytes = value;
+    } else if (key == "rows") {
+      query.rows = value;
+    } else {
+      throw std::runtime_error("Unknown budget `" + key + "'");
+    }
+  }
+}
+
+// Queries are made of a comment line with their name, an optional budget
+// line, optional plan lines, and SQL up to a line ending with a semicolon.
+// Comments before the first query are ignored.
+static std::vector<CorpusQuery> read_corpus(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error("Cannot read " + path);
+  }
+
+  std::vector<CorpusQuery> queries;
+  CorpusQuery current;
+  bool named = false;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty()) {
+      if (current.sql.empty()) {
+        named = false;
+      }
+    } else if (starts_with(line, "-- budget:")) {
+      read_budget(line, current);
+    } else if (starts_with(line, "-- plan:")) {
+      auto step = line.substr(std::strlen("-- plan:"));
+      step.erase(0, step.find_first_not_of(' '));
+      current.plan.push_back(step);
+    } else if (starts_with(line, "--")) {
+      if (!named) {
+        current.name = line.substr(2);
+        current.name.erase(0, current.name.find_first_not_of(' '));
+        named = true;
+      }
+    } else {
+      current.sql += line + "\n";
+      if (line.back() == ';') {
+        if (!named) {
+          throw std::runtime_error("Query without a name in " + path);
+        }
+        queries.push_back(std::move(current));
+        current = CorpusQuery();
+        named = false;
+      }
+    }
+  }
+  return queries;
+}
+
+static Symbol &add_symbol(FakeIndex &index, const std::string &name,
+                          const std::string &scope, const std::string &path) {
+  index.symbols.emplace_back();
+  auto &symbol = index.symbols.back();
+  symbol.set_id(GeneratedSymbolId(index.symbols.size() - 1));
+  symbol.set_name(name);
+  symbol.set_scope(scope);
+  symbol.mutable_definition()->set_file_path(path);
+  symbol.mutable_canonical_declaration()->set_file_path(path);
+  return symbol;
+}
+
+// Adds the symbols that the queries of the README find, after the generated
+// ones
+static void add_readme_symbols(FakeIndex &index) {
+  for (auto scope : {"clang::clangd::", "", "Class::", "llvm::", "clang::"}) {
+    add_symbol(index, "Foo", scope, "llvm/unittests/ADT/STLExtrasTest.cpp");
+  }
+
+  auto baseId = add_symbol(index, "MCAsmInfo", "llvm::",
+                           "llvm/include/llvm/MC/MCAsmInfo.h")
+                 .id();
+  for (auto name :
+       {"NVPTXMCAsmInfo", "MCAsmInfoWasm", "BPFMCAsmInfo", "MockedUpMCAsmInfo",
+        "AVRMCAsmInfo", "MCAsmInfoXCOFF", "MCAsmInfoDarwin", "HackMCAsmInfo",
+        "MCAsmInfoELF", "MCAsmInfoCOFF"}) {
+    auto &subclass = add_symbol(index, name, "llvm::",
+                                std::string("llvm/lib/MC/") + name + ".h");
+    index.relations[0][baseId].push_back(subclass.id());
+  }
+
+  for (auto name : {"align_val_t", "__unexpected", "is_execution_policy",
+                    "__terminate", "is_execution_policy_v"}) {
+    auto &symbol = add_symbol(index, name, "std::", "libcxx/include/new");
+    auto &refs = index.refs[symbol.id()];
+    // A declaration and a reference
+    for (uint32_t kind : {1, 4 | 8}) {
+      refs.emplace_back();
+      refs.back().set_kind(kind);
+      refs.back().mutable_location()->set_file_path("libcxx/include/new");
+    }
+  }
+}
+
+// Number of classes in the `corpus::` scope, which are joined one at a time
+// against their subclasses
+constexpr size_t corpus_classes = 1000;
+// Number of references of `corpus::refs::CorpusRefs`
+constexpr size_t corpus_refs = 1000;
+// Number of symbols named `CorpusFlaky`, and number of them sent by the first
+// search of that name before it fails
+constexpr size_t corpus_flaky = 8;
+constexpr uint32_t corpus_flaky_sent = 3;
+
+// Adds the symbols that the queries of the corpus itself find: the classes of
+// the `corpus::` scope, every other one of which has the next one as a
+// subclass, a symbol whose references are declarations, definitions and,
+// for half of them, plain references, and symbols whose first search fails
+static void add_corpus_symbols(FakeIndex &index) {
+  std::vector<std::string> ids;
+  for (size_t i = 0; i < corpus_classes; i++) {
+    ids.push_back(add_symbol(index, "CorpusClass" + std::to_string(i),
+                             "corpus::", "corpus/Classes.h")
+                   .id());
+  }
+  for (size_t i = 0; i < corpus_classes; i += 2) {
+    index.relations[0][ids[i]].push_back(ids[(i + 1) % corpus_classes]);
+  }
+
+  auto &symbol =
+   add_symbol(index, "CorpusRefs", "corpus::refs::", "corpus/Refs.h");
+  auto &refs = index.refs[symbol.id()];
+  for (size_t i = 0; i < corpus_refs; i++) {
+    // A declaration, a definition, and spelled and unspelled references
+    static const uint32_t kinds[] = {1, 2, 4 | 8, 4};
+    refs.emplace_back();
+    refs.back().set_kind(kinds[i % 4]);
+    auto location = refs.back().mutable_location();
+    location->set_file_path("corpus/Uses" + std::to_string(i % 10) + ".cpp");
+    location->mutable_start()->set_line((uint32_t)i);
+    location->mutable_start()->set_column(4);
+    location->mutable_end()->set_line((uint32_t)i);
+    location->mutable_end()->set_column(14);
+  }
+
+  for (size_t i = 0; i < corpus_flaky; i++) {
+    add_symbol(index, "CorpusFlaky",
+               "corpus::flaky" + std::to_string(i) + "::", "corpus/Flaky.h");
+  }
+  index.fuzzyFindFaults["CorpusFlaky"] = corpus_flaky_sent;
+}
+
+static void check(sqlite3 *db, int rc) {
+  if (rc != SQLITE_OK) {
+    throw std::runtime_error(sqlite3_errmsg(db));
+  }
+}
+
+static void exec(sqlite3 *db, const std::string &sql) {
+  check(db, sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr));
+}
+
+// Returns the detail of each step of the plan of `sql`
+static std::vector<std::string> query_plan(sqlite3 *db,
+                                           const std::string &sql) {
+  sqlite3_stmt *stmt;
+  check(db, sqlite3_prepare_v2(db, ("EXPLAIN QUERY PLAN " + sql).c_str(), -1,
+                               &stmt, nullptr));
+  std::vector<std::string> plan;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    plan.emplace_back((const char *)sqlite3_column_text(stmt, 3));
+  }
+  sqlite3_finalize(stmt);
+  return plan;
+}
+
+static uint64_t received_bytes(sqlite3 *db) {
+  sqlite3_stmt *stmt;
+  check(db, sqlite3_prepare_v2(db, "SELECT total(Bytes) FROM clangql_stats",
+                               -1, &stmt, nullptr));
+  sqlite3_step(stmt);
+  auto bytes = (uint64_t)sqlite3_column_int64(stmt, 0);
+  sqlite3_finalize(stmt);
+  return bytes;
+}
+
+using Connection = std::unique_ptr<sqlite3, int (*)(sqlite3 *)>;
+
+// Opens a connection with the extension loaded and the tables of the README
+// created on `server`
+static Connection connect(const std::string &extension,
+                          const FakeIndexServer &server) {
+  sqlite3 *db;
+  if (sqlite3_open(":memory:", &db) != SQLITE_OK) {
+    throw std::runtime_error("Cannot open a database");
+  }
+  Connection conn(db, sqlite3_close);
+
+  char *err = nullptr;
+  sqlite3_enable_load_extension(db, 1);
+  if (sqlite3_load_extension(db, extension.c_str(), "sqlite3_clangql_init",
+                             &err) != SQLITE_OK) {
+    std::string msg = err ? err : "Cannot load " + extension;
+    sqlite3_free(err);
+    throw std::runtime_error(msg);
+  }
+
+  for (auto table : {"symbols", "base_of", "overridden_by", "refs"}) {
+    exec(db, std::string("CREATE VIRTUAL TABLE llvm_") + table +
+              " USING clangql (" + table + ", " + server.Address() + ")");
+  }
+  return conn;
+}
+
+// Returns the plan of each query that has an expected one. The cost model
+// learns from the scans of every query run by the process, so they are all
+// planned before any of them runs, and each plan only depends on its query.
+static std::vector<std::vector<std::string>>
+plan_queries(const std::string &extension,
+             std::shared_ptr<const FakeIndex> index,
+             const std::vector<CorpusQuery> &queries) {
+  // Planning doesn't call the server
+  FakeIndexServer server(index);
+  auto conn = connect(extension, server);
+
+  std::vector<std::vector<std::string>> plans;
+  for (auto &query : queries) {
+    plans.emplace_back();
+    if (!query.plan.empty()) {
+      plans.back() = query_plan(conn.get(), query.sql);
+    }
+  }
+  return plans;
+}
+
+// Runs `query` on a fresh server and connection, so that no query benefits
+// from what an earlier one cached
+static QueryResult run_query(const std::string &extension,
+                             std::shared_ptr<const FakeIndex> index,
+                             const CorpusQuery &query) {
+  FakeIndexServer server(index);
+  auto conn = connect(extension, server);
+  auto db = conn.get();
+
+  auto callsBefore = server.Calls();
+  auto bytesBefore = received_bytes(db);
+  auto start = std::chrono::steady_clock::now();
+
+  sqlite3_stmt *stmt;
+  check(db, sqlite3_prepare_v2(db, query.sql.c_str(), -1, &stmt, nullptr));
+  uint64_t rows = 0;
+  int rc;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    rows++;
+  }
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_DONE) {
+    throw std::runtime_error(sqlite3_errmsg(db));
+  }
+
+  std::chrono::duration<double, std::milli> elapsed =
+   std::chrono::steady_clock::now() - start;
+  return {elapsed.count(), server.Calls() - callsBefore,
+          received_bytes(db) - bytesBefore, rows};
+}
+
+// Whether each line of `plan` starts with the corresponding line of
+// `expected`
+static bool plan_matches(const std::vector<std::string> &expected,
+                         const std::vector<std::string> &plan) {
+  if (plan.size() != expected.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < plan.size(); i++) {
+    if (plan[i].compare(0, expected[i].size(), expected[i]) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the budgets that `result` goes over, and whether `plan` isn't the
+// expected one, or an empty string
+static std::string over_budget(const CorpusQuery &query,
+                               const QueryResult &result,
+                               const std::vector<std::string> &plan) {
+  std::string res;
+  if (query.rpcs >= 0 && result.rpcs > (uint64_t)query.rpcs) {
+    res += " rpcs>" + std::to_string(query.rpcs);
+  }
+  if (query.bytes >= 0 && result.bytes > (uint64_t)query.bytes) {
+    res += " bytes>" + std::to_string(query.bytes);
+  }
+  if (query.rows >= 0 && result.rows != (uint64_t)query.rows) {
+    res += " rows!=" + std::to_string(query.rows);
+  }
+  if (!query.plan.empty() && !plan_matches(query.plan, plan)) {
+    res += " plan";
+  }
+  return res;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    std::fprintf(stderr, "usage: %s EXTENSION CORPUS\n", argv[0]);
+    return 2;
+  }
+
+  try {
+    auto queries = read_corpus(argv[2]);
+    auto index = GenerateIndex(IndexShape());
+    add_readme_symbols(index);
+    add_corpus_symbols(index);
+    auto shared = std::make_shared<const FakeIndex>(std::move(index));
+    auto plans = plan_queries(argv[1], shared, queries);
+
+    int failures = 0;
+    std::printf("%-32s %10s %6s %10s %6s\n", "query", "ms", "rpcs", "bytes",
+                "rows");
+    for (size_t i = 0; i < queries.size(); i++) {
+      auto &query = queries[i];
+      auto &plan = plans[i];
+      auto result = run_query(argv[1], shared, query);
+      auto over = over_budget(query, result, plan);
+      std::printf("%-32s %10.2f %6llu %10llu %6llu%s%s\n", query.name.c_str(),
+                  result.millis, (unsigned long long)result.rpcs,
+                  (unsigned long long)result.bytes,
+                  (unsigned long long)result.rows, over.empty() ? "" : "  FAIL",
+                  over.c_str());
+      if (!plan_matches(query.plan, plan)) {
+        for (auto &step : plan) {
+          std::printf("  plan: %s\n", step.c_str());
+        }
+      }
+      failures += !over.empty();
+    }
+    return failures ? 1 : 0;
+  } catch (std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 2;
+  }
+}
@@ -0,0 +1,168 @@
+#include "Allocations.hpp"
+#include "BenchDatabase.hpp"
+#include "FakeIndex.hpp"
+#include "IndexGenerator.hpp"
+#include "SymbolId.hpp"
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Number of ids in the `ids` table of `bench_database`
+constexpr size_t bench_ids = 4096;
+
+// Index read by every benchmark: the file written by clangql_genindex that
+// CLANGQL_BENCH_INDEX names, or else a generated index of uniform symbols
+static std::shared_ptr<const FakeIndex> bench_index() {
+  auto path = std::getenv("CLANGQL_BENCH_INDEX");
+  return std::make_shared<const FakeIndex>(
+   path ? ReadFakeIndex(path) : GenerateIndex(IndexShape()));
+}
+
+// Server of the index read by every benchmark. Symbols that came over the
+// wire are cached per server, so the first 65536 symbols of this index end
+// up being served from the cache by `Id` lookups.
+static FakeIndexServer &bench_server() {
+  static FakeIndexServer server(bench_index());
+  return server;
+}
+
+// Database with clangql tables reading from the bench server, created with
+// `options`, and an `ids` table holding the ids of the first symbols
+static std::unique_ptr<BenchDatabase>
+bench_database(const std::string &options = "") {
+  auto db = std::make_unique<BenchDatabase>();
+  auto args = bench_server().Address() + options;
+  db->Exec("CREATE VIRTUAL TABLE s USING clangql(symbols, " + args + ")");
+  db->Exec("CREATE VIRTUAL TABLE r USING clangql(refs, " + args + ")");
+  db->Exec("CREATE VIRTUAL TABLE b USING clangql(base_of, " + args + ")");
+  db->Exec("CREATE TABLE ids(id TEXT PRIMARY KEY)");
+  db->Exec("BEGIN");
+  for (size_t i = 0; i < bench_ids; i++) {
+    db->Exec("INSERT INTO ids VALUES ('" + GeneratedSymbolId(i) + "')");
+  }
+  db->Exec("COMMIT");
+  return db;
+}
+
+// Runs `sql`, which counts the rows it reads, for every iteration. Reports
+// rows per second and the number of allocations per row.
+static void run_query(benchmark::State &state, BenchDatabase &db,
+                      const std::string &sql) {
+  // Warms up the cache and the connection
+  db.Scalar(sql);
+
+  int64_t rows = 0;
+  auto allocationsBefore = AllocationCount();
+  for (auto _ : state) {
+    rows += db.Scalar(sql);
+  }
+  state.SetItemsProcessed(rows);
+  state.counters["allocs_per_row"] =
+   (double)(AllocationCount() - allocationsBefore) / (double)rows;
+}
+
+// Parses the hex ids of 4096 symbols, as done by `RowId` and lookups by
+// integer ids
+static void BM_RowIdParse(benchmark::State &state) {
+  std::vector<std::string> ids;
+  for (size_t i = 0; i < bench_ids; i++) {
+    ids.push_back(GeneratedSymbolId(i));
+  }
+
+  for (auto _ : state) {
+    for (auto &id : ids) {
+      uint64_t value;
+      benchmark::DoNotOptimize(ParseSymbolId(id, value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * (int64_t)ids.size());
+}
+BENCHMARK(BM_RowIdParse);
+
+// Columns read by BM_SymbolColumns, the longest one last
+static const char *const symbol_columns[] = {
+ "Id",           "Name",         "Scope",       "Signature",
+ "ReturnType",   "Type",         "DefPath",     "DefStartLine",
+ "DefStartCol",  "DefEndLine",   "DefEndCol",   "DeclPath",
+ "DeclStartLine", "DeclStartCol", "DeclEndLine", "DeclEndCol",
+ "Kind",         "SubKind",      "Language",    "Documentation"};
+
+// Reads state.range(0) columns of 4096 cached symbols, fetched by a single
+// Filter, so the time is mostly spent in `Column`. Items are columns.
+static void BM_SymbolColumns(benchmark::State &state) {
+  auto db = bench_database();
+  std::string sql = "SELECT ";
+  for (int64_t i = 0; i < state.range(0); i++) {
+    sql += i ? ", " : "";
+    sql += "count(" + std::string(symbol_columns[i]) + ")";
+  }
+  sql += " FROM s WHERE Id IN (SELECT id FROM ids)";
+
+  db->Scalar(sql);
+  for (auto _ : state) {
+    db->Scalar(sql);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          (int64_t)bench_ids);
+}
+BENCHMARK(BM_SymbolColumns)
+ ->ArgName("columns")
+ ->Arg(1)
+ ->Arg(4)
+ ->Arg(20);
+
+// Probes the symbols table once for each of 4096 cached ids, as the inner
+// side of a join does, so the time is mostly spent setting up `Filter`.
+// Items are probes. CROSS JOIN keeps SQLite from scanning the symbols
+// instead.
+static void BM_FilterSetup(benchmark::State &state) {
+  auto db = bench_database();
+  run_query(state, *db,
+            "SELECT count(s.Name) FROM ids CROSS JOIN s ON s.Id = ids.id");
+}
+BENCHMARK(BM_FilterSetup);
+
+struct StreamCase {
+  const char *name;
+  const char *options;
+  const char *sql;
+};
+
+constexpr const char *scan_sql = "SELECT count(Name) FROM s";
+constexpr const char *lookup_sql =
+ "SELECT count(Name) FROM s WHERE Id IN (SELECT id FROM ids)";
+constexpr const char *refs_sql =
+ "SELECT count(Path) FROM r WHERE SymbolId IN (SELECT id FROM ids)";
+constexpr const char *relations_sql =
+ "SELECT count(Object) FROM b WHERE Subject IN (SELECT id FROM ids)";
+
+// One query for each kind of stream rows can come from
+static const StreamCase stream_cases[] = {
+ {"fuzzyfind", "", scan_sql},
+ {"fuzzyfind_wire", ", selective_decode=1", scan_sql},
+ {"fuzzyfind_prefetch", ", prefetch=256", scan_sql},
+ {"fuzzyfind_paged", ", page_size=10000", scan_sql},
+ {"lookup_cached", "", lookup_sql},
+ {"refs", "", refs_sql},
+ {"refs_prefetch", ", prefetch=256", refs_sql},
+ {"relations", "", relations_sql},
+};
+
+// Rows per second read from the stream selected by state.range(0), with the
+// allocations made for each row
+static void BM_StreamRows(benchmark::State &state) {
+  auto &streamCase = stream_cases[state.range(0)];
+  state.SetLabel(streamCase.name);
+  auto db = bench_database(streamCase.options);
+  run_query(state, *db, streamCase.sql);
+}
+BENCHMARK(BM_StreamRows)
+ ->ArgName("stream")
+ ->DenseRange(0, sizeof(stream_cases) / sizeof(*stream_cases) - 1)
+ ->Unit(benchmark::kMillisecond)
+ ->UseRealTime();
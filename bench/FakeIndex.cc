@@ -0,0 +1,368 @@
+#include "FakeIndex.hpp"
+#include "Service.grpc.pb.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+
+using namespace clang::clangd::remote;
+using clang::clangd::remote::v1::SymbolIndex;
+
+// Sends results until the limit of the request is reached, followed by the
+// final result telling whether some were left out
+template <typename Reply, typename T> class ReplyWriter {
+  grpc::ServerWriter<Reply> &m_writer;
+  uint32_t m_limit;
+  uint32_t m_sent = 0;
+  bool m_hasMore = false;
+  bool m_broken = false;
+  Reply m_reply;
+
+public:
+  // A limit of 0 means no limit, as for clangd
+  ReplyWriter(grpc::ServerWriter<Reply> &writer, uint32_t limit)
+    : m_writer(writer), m_limit(limit) {}
+
+  // Returns false if no more results should be sent
+  bool Write(const T &result) {
+    if (m_limit && m_sent == m_limit) {
+      m_hasMore = true;
+      return false;
+    }
+    m_reply.mutable_stream_result()->CopyFrom(result);
+    if (!m_writer.Write(m_reply)) {
+      // The client is gone
+      m_broken = true;
+      return false;
+    }
+    m_sent++;
+    return true;
+  }
+
+  grpc::Status Finish() {
+    if (m_broken) {
+      return grpc::Status::CANCELLED;
+    }
+    m_reply.mutable_final_result()->set_has_more(m_hasMore);
+    m_writer.Write(m_reply);
+    return grpc::Status::OK;
+  }
+};
+
+// Whether the characters of `query` appear in `name` in order, ignoring case,
+// which is what clangd's fuzzy matcher requires of a match before ranking it
+static bool fuzzy_matches(const std::string &query, const std::string &name) {
+  size_t next = 0;
+  for (char c : name) {
+    if (next == query.size()) {
+      break;
+    }
+    if (std::tolower((unsigned char)c) ==
+        std::tolower((unsigned char)query[next])) {
+      next++;
+    }
+  }
+  return next == query.size();
+}
+
+class FakeIndexService final : public SymbolIndex::Service {
+  std::shared_ptr<const FakeIndex> m_index;
+  std::unordered_map<std::string, const Symbol *> m_byId;
+  // Queries of `FakeIndex::fuzzyFindFaults` that already failed once
+  std::unordered_set<std::string> m_failed;
+  std::mutex m_failedMutex;
+
+  const Symbol *Find(const std::string &id) const {
+    auto it = m_byId.find(id);
+    return it == m_byId.end() ? nullptr : it->second;
+  }
+
+  // Returns the number of results after which a FuzzyFind of `query` fails,
+  // or -1 if it doesn't
+  int64_t FuzzyFindFault(const std::string &query) {
+    auto fault = m_index->fuzzyFindFaults.find(query);
+    if (fault == m_index->fuzzyFindFaults.end()) {
+      return -1;
+    }
+    std::lock_guard<std::mutex> lock(m_failedMutex);
+    return m_failed.insert(query).second ? fault->second : -1;
+  }
+
+public:
+  std::atomic<uint64_t> calls{0};
+
+  explicit FakeIndexService(std::shared_ptr<const FakeIndex> index)
+    : m_index(std::move(index)) {
+    for (auto &symbol : m_index->symbols) {
+      m_byId[symbol.id()] = &symbol;
+    }
+  }
+
+  grpc::Status Lookup(grpc::ServerContext *ctx, const LookupRequest *req,
+                      grpc::ServerWriter<LookupReply> *writer) override {
+    calls++;
+    ReplyWriter<LookupReply, Symbol> replies(*writer, 0);
+    for (auto &id : req->ids()) {
+      auto symbol = Find(id);
+      if (symbol && !replies.Write(*symbol)) {
+        break;
+      }
+    }
+    return replies.Finish();
+  }
+
+  grpc::Status
+  FuzzyFind(grpc::ServerContext *ctx, const FuzzyFindRequest *req,
+            grpc::ServerWriter<FuzzyFindReply> *writer) override {
+    calls++;
+    ReplyWriter<FuzzyFindReply, Symbol> replies(*writer, req->limit());
+    auto failAfter = FuzzyFindFault(req->query());
+    for (auto &symbol : m_index->symbols) {
+      if (!fuzzy_matches(req->query(), symbol.name())) {
+        continue;
+      }
+      // Listed scopes only restrict the results if any_scope is not set
+      if (!req->any_scope() && req->scopes_size() > 0) {
+        bool inScope = false;
+        for (auto &scope : req->scopes()) {
+          inScope = inScope || scope == symbol.scope();
+        }
+        if (!inScope) {
+          continue;
+        }
+      }
+      if (failAfter-- == 0) {
+        return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Injected fault");
+      }
+      if (!replies.Write(symbol)) {
+        break;
+      }
+    }
+    return replies.Finish();
+  }
+
+  grpc::Status Refs(grpc::ServerContext *ctx, const RefsRequest *req,
+                    grpc::ServerWriter<RefsReply> *writer) override {
+    calls++;
+    ReplyWriter<RefsReply, Ref> replies(*writer, req->limit());
+    for (auto &id : req->ids()) {
+      auto refs = m_index->refs.find(id);
+      if (refs == m_index->refs.end()) {
+        continue;
+      }
+      for (auto &ref : refs->second) {
+        // As in clangd, a filter of 0 matches nothing
+        if ((ref.kind() & req->filter()) == 0) {
+          continue;
+        }
+        if (!replies.Write(ref)) {
+          return replies.Finish();
+        }
+      }
+    }
+    return replies.Finish();
+  }
+
+  grpc::Status
+  Relations(grpc::ServerContext *ctx, const RelationsRequest *req,
+            grpc::ServerWriter<RelationsReply> *writer) override {
+    calls++;
+    if (req->predicate() > 1) {
+      return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                          "Unknown relation kind");
+    }
+
+    auto &relations = m_index->relations[req->predicate()];
+    ReplyWriter<RelationsReply, Relation> replies(*writer, req->limit());
+    Relation relation;
+    for (auto &subject : req->subjects()) {
+      auto objects = relations.find(subject);
+      if (objects == relations.end()) {
+        continue;
+      }
+      relation.set_subject_id(subject);
+      for (auto &id : objects->second) {
+        auto object = Find(id);
+        if (!object) {
+          continue;
+        }
+        relation.mutable_object()->CopyFrom(*object);
+        if (!replies.Write(relation)) {
+          return replies.Finish();
+        }
+      }
+    }
+    return replies.Finish();
+  }
+};
+
+FakeIndexServer::FakeIndexServer(std::shared_ptr<const FakeIndex> index,
+                                 const std::string &address)
+  : m_service(std::make_unique<FakeIndexService>(std::move(index))) {
+  int port = 0;
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort(address, grpc::InsecureServerCredentials(), &port);
+  builder.RegisterService(m_service.get());
+  m_server = builder.BuildAndStart();
+  if (!m_server || port == 0) {
+    throw std::runtime_error("Cannot start the fake index server on " +
+                             address);
+  }
+  m_address = address.substr(0, address.rfind(':') + 1) + std::to_string(port);
+}
+
+FakeIndexServer::~FakeIndexServer() { m_server->Shutdown(); }
+
+uint64_t FakeIndexServer::Calls() const { return m_service->calls; }
+
+// Files start with this, followed by the symbols, the references of each
+// symbol and the relations of each kind. Messages are serialized protobufs,
+// and every string and message is preceded by its size as 4 little-endian
+// bytes, as is every list by its length.
+constexpr char index_magic[8] = {'C', 'Q', 'L', 'I', 'N', 'D', 'X', '1'};
+
+class IndexWriter {
+  std::ofstream m_file;
+  std::string m_buffer;
+
+public:
+  explicit IndexWriter(const std::string &path)
+    : m_file(path, std::ios::binary | std::ios::trunc) {
+    if (!m_file) {
+      throw std::runtime_error("Cannot write " + path);
+    }
+    m_file.write(index_magic, sizeof(index_magic));
+  }
+
+  void Size(size_t size) {
+    if (size > UINT32_MAX) {
+      throw std::runtime_error("Index too large");
+    }
+    char bytes[4];
+    for (int i = 0; i < 4; i++) {
+      bytes[i] = (char)(size >> (8 * i));
+    }
+    m_file.write(bytes, sizeof(bytes));
+  }
+
+  void String(const std::string &string) {
+    Size(string.size());
+    m_file.write(string.data(), (std::streamsize)string.size());
+  }
+
+  void Message(const google::protobuf::MessageLite &message) {
+    m_buffer.clear();
+    message.AppendToString(&m_buffer);
+    String(m_buffer);
+  }
+
+  void Finish(const std::string &path) {
+    m_file.close();
+    if (!m_file) {
+      throw std::runtime_error("Cannot write " + path);
+    }
+  }
+};
+
+class IndexReader {
+  std::ifstream m_file;
+  std::string m_path;
+  std::string m_buffer;
+
+  void Read(char *dest, size_t size) {
+    if (!m_file.read(dest, (std::streamsize)size)) {
+      throw std::runtime_error(m_path + " is truncated");
+    }
+  }
+
+public:
+  explicit IndexReader(const std::string &path)
+    : m_file(path, std::ios::binary), m_path(path) {
+    if (!m_file) {
+      throw std::runtime_error("Cannot read " + path);
+    }
+    char magic[sizeof(index_magic)];
+    Read(magic, sizeof(magic));
+    if (!std::equal(magic, magic + sizeof(magic), index_magic)) {
+      throw std::runtime_error(path + " is not an index file");
+    }
+  }
+
+  size_t Size() {
+    unsigned char bytes[4];
+    Read((char *)bytes, sizeof(bytes));
+    return (size_t)bytes[0] | (size_t)bytes[1] << 8 | (size_t)bytes[2] << 16 |
+           (size_t)bytes[3] << 24;
+  }
+
+  std::string String() {
+    std::string res(Size(), '\0');
+    Read(&res[0], res.size());
+    return res;
+  }
+
+  void Message(google::protobuf::MessageLite &message) {
+    m_buffer.resize(Size());
+    Read(&m_buffer[0], m_buffer.size());
+    if (!message.ParseFromString(m_buffer)) {
+      throw std::runtime_error(m_path + " is corrupted");
+    }
+  }
+};
+
+void WriteFakeIndex(const FakeIndex &index, const std::string &path) {
+  IndexWriter writer(path);
+  writer.Size(index.symbols.size());
+  for (auto &symbol : index.symbols) {
+    writer.Message(symbol);
+  }
+  writer.Size(index.refs.size());
+  for (auto &refs : index.refs) {
+    writer.String(refs.first);
+    writer.Size(refs.second.size());
+    for (auto &ref : refs.second) {
+      writer.Message(ref);
+    }
+  }
+  for (auto &relations : index.relations) {
+    writer.Size(relations.size());
+    for (auto &objects : relations) {
+      writer.String(objects.first);
+      writer.Size(objects.second.size());
+      for (auto &id : objects.second) {
+        writer.String(id);
+      }
+    }
+  }
+  writer.Finish(path);
+}
+
+FakeIndex ReadFakeIndex(const std::string &path) {
+  IndexReader reader(path);
+  FakeIndex index;
+  index.symbols.resize(reader.Size());
+  for (auto &symbol : index.symbols) {
+    reader.Message(symbol);
+  }
+  for (auto count = reader.Size(); count > 0; count--) {
+    auto &refs = index.refs[reader.String()];
+    refs.resize(reader.Size());
+    for (auto &ref : refs) {
+      reader.Message(ref);
+    }
+  }
+  for (auto &relations : index.relations) {
+    for (auto count = reader.Size(); count > 0; count--) {
+      auto &objects = relations[reader.String()];
+      objects.resize(reader.Size());
+      for (auto &id : objects) {
+        id = reader.String();
+      }
+    }
+  }
+  return index;
+}
@@ -0,0 +1,61 @@
+#ifndef FAKEINDEX_HPP
+#define FAKEINDEX_HPP
+#include "Index.pb.h"
+#include <grpcpp/grpcpp.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Symbols, references and relations served by a FakeIndexServer
+struct FakeIndex {
+  std::vector<clang::clangd::remote::Symbol> symbols;
+  // References of each symbol, by id
+  std::unordered_map<std::string, std::vector<clang::clangd::remote::Ref>>
+   refs;
+  // Ids of the objects related to each subject, for each predicate of a
+  // RelationsRequest (0 for base_of, 1 for overridden_by)
+  std::unordered_map<std::string, std::vector<std::string>> relations[2];
+  // FuzzyFind queries whose first call fails after sending this many results,
+  // as when the server goes away in the middle of a reply. They are not
+  // written by `WriteFakeIndex`.
+  std::unordered_map<std::string, uint32_t> fuzzyFindFaults;
+};
+
+// Writes `index` to `path`, in a binary format read by `ReadFakeIndex`. Throws
+// a std::runtime_error on failure.
+void WriteFakeIndex(const FakeIndex &index, const std::string &path);
+
+// Reads an index written by `WriteFakeIndex`, or throws a std::runtime_error
+FakeIndex ReadFakeIndex(const std::string &path);
+
+class FakeIndexService;
+
+// SymbolIndex server running in the same process, by default on a port of the
+// loopback interface, so benchmarks don't need a clangd index server. Requests
+// are answered the way clangd does, except that FuzzyFind results are not
+// ranked: they come in the order of `FakeIndex::symbols`.
+class FakeIndexServer {
+  std::unique_ptr<FakeIndexService> m_service;
+  std::unique_ptr<grpc::Server> m_server;
+  std::string m_address;
+
+public:
+  // `address` is a host and port to listen on. A port of 0 picks any free
+  // port.
+  explicit FakeIndexServer(std::shared_ptr<const FakeIndex> index,
+                           const std::string &address = "127.0.0.1:0");
+  ~FakeIndexServer();
+  FakeIndexServer(const FakeIndexServer &) = delete;
+  FakeIndexServer &operator=(const FakeIndexServer &) = delete;
+
+  // Connection string of the server, to create tables with
+  const std::string &Address() const { return m_address; }
+
+  // Number of requests received so far
+  uint64_t Calls() const;
+};
+
+#endif
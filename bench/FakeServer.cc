@@ -0,0 +1,34 @@
+// Serves an index written by clangql_genindex until interrupted, so that
+// clangql can be tried out or profiled from the sqlite3 shell without a clangd
+// index server:
+//
+//   clangql_fake_server llvm.idx [HOST:PORT]
+#include "FakeIndex.hpp"
+
+#include <cstdio>
+#include <exception>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+int main(int argc, char **argv) {
+  if (argc != 2 && argc != 3) {
+    std::fprintf(stderr, "usage: %s INDEX [HOST:PORT]\n", argv[0]);
+    return 2;
+  }
+
+  try {
+    auto index = std::make_shared<const FakeIndex>(ReadFakeIndex(argv[1]));
+    FakeIndexServer server(index, argc == 3 ? argv[2] : "127.0.0.1:0");
+    std::printf("Serving %zu symbols on %s\n", index->symbols.size(),
+                server.Address().c_str());
+    std::fflush(stdout);
+    for (;;) {
+      std::this_thread::sleep_for(std::chrono::hours(1));
+    }
+  } catch (std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+}
@@ -0,0 +1,83 @@
+// Generates an index resembling clangd's index of LLVM and writes it to a
+// file, to be served by clangql_fake_server or read by the benchmarks:
+//
+//   clangql_genindex [--symbols N] [--seed N] llvm.idx
+#include "FakeIndex.hpp"
+#include "IndexGenerator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+
+// Prints the extremes of `index` that benchmarks rely on
+static void print_summary(const FakeIndex &index) {
+  size_t refs = 0, mostRefs = 0, mostSubclasses = 0, mostOverrides = 0;
+  size_t deepestScope = 0, longestDocumentation = 0;
+  for (auto &symbol : index.symbols) {
+    auto &scope = symbol.scope();
+    size_t depth = 0;
+    for (size_t i = scope.find("::"); i != std::string::npos;
+         i = scope.find("::", i + 2)) {
+      depth++;
+    }
+    deepestScope = std::max(deepestScope, depth);
+    longestDocumentation =
+     std::max(longestDocumentation, symbol.documentation().size());
+  }
+  for (auto &symbolRefs : index.refs) {
+    refs += symbolRefs.second.size();
+    mostRefs = std::max(mostRefs, symbolRefs.second.size());
+  }
+  for (auto &objects : index.relations[0]) {
+    mostSubclasses = std::max(mostSubclasses, objects.second.size());
+  }
+  for (auto &objects : index.relations[1]) {
+    mostOverrides = std::max(mostOverrides, objects.second.size());
+  }
+
+  std::printf("symbols:               %zu\n", index.symbols.size());
+  std::printf("refs:                  %zu\n", refs);
+  std::printf("most refs:             %zu\n", mostRefs);
+  std::printf("most subclasses:       %zu\n", mostSubclasses);
+  std::printf("most overrides:        %zu\n", mostOverrides);
+  std::printf("deepest scope:         %zu\n", deepestScope);
+  std::printf("longest documentation: %zu\n", longestDocumentation);
+}
+
+int main(int argc, char **argv) {
+  LlvmIndexShape shape;
+  const char *output = nullptr;
+  try {
+    for (int i = 1; i < argc; i++) {
+      if (i + 1 < argc && std::strcmp(argv[i], "--symbols") == 0) {
+        shape.symbols = std::stoull(argv[++i]);
+      } else if (i + 1 < argc && std::strcmp(argv[i], "--seed") == 0) {
+        shape.seed = std::stoull(argv[++i]);
+      } else if (!output && argv[i][0] != '-') {
+        output = argv[i];
+      } else {
+        output = nullptr;
+        break;
+      }
+    }
+  } catch (std::exception &) {
+    output = nullptr;
+  }
+  if (!output) {
+    std::fprintf(stderr, "usage: %s [--symbols N] [--seed N] OUTPUT\n",
+                 argv[0]);
+    return 2;
+  }
+
+  try {
+    auto index = GenerateLlvmIndex(shape);
+    WriteFakeIndex(index, output);
+    print_summary(index);
+    return 0;
+  } catch (std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+}
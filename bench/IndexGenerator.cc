@@ -0,0 +1,553 @@
+#include "IndexGenerator.hpp"
+#include "SymbolId.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <set>
+#include <utility>
+
+using namespace clang::clangd::remote;
+
+// clangd's SymbolKind::Function and SymbolLanguage::CXX
+constexpr uint32_t function_kind = 12;
+constexpr uint32_t cxx_language = 2;
+
+// Number of symbols declared in each file
+constexpr size_t symbols_per_file = 100;
+
+std::string GeneratedSymbolId(size_t i) {
+  // Spread the ids over the whole range, like hashes
+  return FormatSymbolId((uint64_t)(i + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+static void set_location(SymbolLocation &location, const std::string &path,
+                         uint32_t line) {
+  location.set_file_path(path);
+  location.mutable_start()->set_line(line);
+  location.mutable_start()->set_column(4);
+  location.mutable_end()->set_line(line);
+  location.mutable_end()->set_column(20);
+}
+
+FakeIndex GenerateIndex(const IndexShape &shape) {
+  FakeIndex index;
+  index.symbols.resize(shape.symbols);
+  std::string documentation(shape.documentationSize, 'x');
+
+  for (size_t i = 0; i < shape.symbols; i++) {
+    auto &symbol = index.symbols[i];
+    auto id = GeneratedSymbolId(i);
+    auto file = "src/file" + std::to_string(i / symbols_per_file);
+    auto line = (uint32_t)(i % symbols_per_file) * 10 + 1;
+
+    symbol.set_id(id);
+    symbol.set_name("symbol" + std::to_string(i));
+    symbol.set_scope("ns" + std::to_string(i % shape.scopes) + "::");
+    symbol.mutable_info()->set_kind(function_kind);
+    symbol.mutable_info()->set_language(cxx_language);
+    set_location(*symbol.mutable_definition(), file + ".cpp", line);
+    set_location(*symbol.mutable_canonical_declaration(), file + ".h", line);
+    symbol.set_references((int32_t)shape.refsPerSymbol);
+    symbol.set_signature("(int a, const char *b)");
+    symbol.set_documentation(documentation);
+    symbol.set_return_type("int");
+    symbol.set_type("int (int, const char *)");
+
+    auto &refs = index.refs[id];
+    refs.resize(shape.refsPerSymbol);
+    for (size_t j = 0; j < shape.refsPerSymbol; j++) {
+      // The declaration, the definition, then spelled references
+      uint32_t kind = j == 0 ? 1 : j == 1 ? 2 : 4 | 8;
+      set_location(*refs[j].mutable_location(),
+                   "src/user" + std::to_string(j) + ".cpp", line);
+      refs[j].set_kind(kind);
+    }
+
+    auto base = i - i % shape.classSize;
+    if (base != i) {
+      auto baseId = GeneratedSymbolId(base);
+      index.relations[0][baseId].push_back(id);
+      index.relations[1][baseId].push_back(id);
+    }
+  }
+  return index;
+}
+
+// clangd's SymbolKind values of the symbols of an LLVM index
+constexpr uint32_t macro_kind = 4;
+constexpr uint32_t enum_kind = 5;
+constexpr uint32_t struct_kind = 6;
+constexpr uint32_t class_kind = 7;
+constexpr uint32_t variable_kind = 13;
+constexpr uint32_t field_kind = 14;
+constexpr uint32_t enum_constant_kind = 15;
+constexpr uint32_t method_kind = 16;
+constexpr uint32_t static_method_kind = 18;
+constexpr uint32_t constructor_kind = 22;
+constexpr uint32_t destructor_kind = 23;
+
+constexpr uint32_t c_language = 0;
+
+// clangd's SymbolProperty, Symbol::SymbolFlag and RefKind values
+constexpr uint32_t generic_property = 1 << 0;
+constexpr uint32_t template_specialization_property = 1 << 2;
+constexpr uint32_t unit_test_property = 1 << 3;
+constexpr uint32_t code_completion_flag = 1 << 0;
+constexpr uint32_t visible_outside_file_flag = 1 << 3;
+constexpr uint32_t declaration_ref = 1;
+constexpr uint32_t definition_ref = 2;
+constexpr uint32_t reference_ref = 4;
+constexpr uint32_t spelled_ref = 8;
+
+// Most references a symbol of an LLVM index has, and longest documentation
+constexpr size_t max_refs = 100000;
+constexpr size_t max_documentation_size = 16384;
+constexpr size_t max_namespace_depth = 5;
+constexpr size_t max_class_nesting = 2;
+
+static const char *const nouns[] = {
+ "Value",    "Type",     "Decl",       "Expr",      "Stmt",     "Inst",
+ "Builder",  "Info",     "Context",    "Map",       "Set",      "Pass",
+ "Analysis", "Manager",  "Module",     "Function",  "Block",    "Loop",
+ "Target",   "Machine",  "Register",   "Operand",   "Node",     "Graph",
+ "Scope",    "Symbol",   "Index",      "Token",     "Lexer",    "Parser",
+ "Attr",     "Template", "Record",     "Field",     "Error",    "Stream",
+ "Buffer",   "Table",    "Entry",      "Cache",     "Printer",  "Writer",
+ "Reader",   "Visitor",  "Matcher",    "Callback",  "Option",   "Diagnostic",
+ "Location", "Range",    "Section",    "Object",    "Alias",    "Memory",
+ "Use",      "Call",     "Constant",   "Global",    "Pointer",  "Array",
+ "Vector",   "String",   "File",       "Path",      "Tree",     "Edge"};
+
+static const char *const verbs[] = {
+ "get",     "set",    "create",  "build",   "find",    "lookup",
+ "visit",   "emit",   "print",   "dump",    "is",      "has",
+ "add",     "remove", "insert",  "erase",   "compute", "update",
+ "match",   "parse",  "lower",   "resolve", "clone",   "replace",
+ "verify",  "run",    "handle",  "collect", "analyze", "transform"};
+
+static const char *const namespace_names[] = {
+ "detail", "sys",      "orc",          "yaml",     "json",   "cl",
+ "object", "dwarf",    "codeview",     "remote",   "index",  "tooling",
+ "clangd", "internal", "ast_matchers", "impl",     "sema",   "driver",
+ "format", "dataflow", "ento",         "mc",       "opt",    "pdb",
+ "vfs",    "rdf",      "lsp",          "trace",    "markup", "symbolize"};
+
+static const char *const value_types[] = {
+ "void",        "bool",      "unsigned", "int",           "Value *",
+ "StringRef",   "Error",     "uint64_t", "std::string",   "Type *",
+ "const APInt &", "ArrayRef<Value *>", "Expected<unsigned>", "size_t"};
+
+static const char *const parameters[] = {
+ "Value *V",          "unsigned Idx",     "StringRef Name", "bool Enable",
+ "const APInt &Imm",  "Type *Ty",         "raw_ostream &OS", "uint64_t Size",
+ "ArrayRef<int> Mask", "SMLoc Loc",       "LLVMContext &C", "Twine Msg"};
+
+// SplitMix64, used rather than <random> whose distributions differ between
+// standard libraries
+class Random {
+  uint64_t m_state;
+
+public:
+  explicit Random(uint64_t seed) : m_state(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (m_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  // Uniform in [0, 1)
+  double Unit() { return (double)(Next() >> 11) * 0x1.0p-53; }
+
+  // Uniform in [0, n)
+  size_t Below(size_t n) { return (size_t)(Unit() * (double)n); }
+
+  // Uniform in [low, high]
+  size_t Between(size_t low, size_t high) {
+    return low + Below(high - low + 1);
+  }
+
+  bool Chance(double probability) { return Unit() < probability; }
+
+  template <size_t N> const char *Pick(const char *const (&words)[N]) {
+    return words[Below(N)];
+  }
+};
+
+struct Namespace {
+  std::string scope;
+  std::string project;
+  // Directory of the files of the namespace within its project, such as
+  // `/Support`
+  std::string dir;
+  size_t depth;
+};
+
+struct GeneratedFile {
+  const Namespace *ns;
+  std::string name;
+  std::string header;
+  std::string source;
+  // Line of the next declaration of the file
+  uint32_t line;
+};
+
+struct GeneratedClass {
+  std::string id;
+  // Names and ids of the virtual methods that subclasses may override
+  std::vector<std::pair<std::string, std::string>> virtuals;
+};
+
+class LlvmIndexGenerator {
+  const LlvmIndexShape &m_shape;
+  Random m_random;
+  FakeIndex m_index;
+  std::vector<Namespace> m_namespaces;
+  // Every generated path, where references are spread
+  std::vector<std::string> m_paths;
+  // Classes that regular classes may derive from. Early ones are picked far
+  // more often, and end up with thousands of subclasses.
+  std::vector<GeneratedClass> m_classes;
+  // Base of the test fixtures of unit test files
+  GeneratedClass m_testClass;
+  // Text documentation is taken from
+  std::string m_text;
+
+  bool Full() const { return m_index.symbols.size() >= m_shape.symbols; }
+
+  std::string CamelCase(size_t words) {
+    std::string res;
+    for (size_t i = 0; i < words; i++) {
+      res += m_random.Pick(nouns);
+    }
+    return res;
+  }
+
+  std::string MethodName() {
+    return m_random.Pick(verbs) + CamelCase(m_random.Between(1, 2));
+  }
+
+  void SetLocation(SymbolLocation &location, const std::string &path,
+                   uint32_t line, size_t length) {
+    auto column = (uint32_t)m_random.Between(0, 12);
+    location.set_file_path(path);
+    location.mutable_start()->set_line(line);
+    location.mutable_start()->set_column(column);
+    location.mutable_end()->set_line(line);
+    location.mutable_end()->set_column(column + (uint32_t)length);
+  }
+
+  // Half the symbols have none, and the rest mostly a sentence or two
+  std::string Documentation() {
+    if (m_random.Chance(0.5)) {
+      return {};
+    }
+    auto unit = m_random.Unit();
+    auto size = unit * max_documentation_size < 30
+                 ? max_documentation_size
+                 : (size_t)(30 / unit);
+    return m_text.substr(m_random.Below(m_text.size() - size), size);
+  }
+
+  // Adds a symbol declared in the header of `file` and defined in its source
+  // if `defined` is set
+  Symbol &Add(GeneratedFile &file, uint32_t kind, const std::string &name,
+              const std::string &scope, bool defined) {
+    auto id = GeneratedSymbolId(m_index.symbols.size());
+    m_index.symbols.emplace_back();
+    auto &symbol = m_index.symbols.back();
+    symbol.set_id(id);
+    symbol.set_name(name);
+    symbol.set_scope(scope);
+    symbol.mutable_info()->set_kind(kind);
+    symbol.mutable_info()->set_language(kind == macro_kind ? c_language
+                                                           : cxx_language);
+    symbol.set_flags(code_completion_flag | visible_outside_file_flag);
+    symbol.set_documentation(Documentation());
+
+    file.line += (uint32_t)m_random.Between(1, 30);
+    SetLocation(*symbol.mutable_canonical_declaration(), file.header,
+                file.line, name.size());
+    if (defined) {
+      SetLocation(*symbol.mutable_definition(), file.source,
+                  (uint32_t)m_random.Between(1, 5000), name.size());
+    } else {
+      *symbol.mutable_definition() = symbol.canonical_declaration();
+    }
+
+    auto header = symbol.add_headers();
+    header->set_header("\"" + file.header.substr(file.header.find("/include/") +
+                                                 9) +
+                       "\"");
+    header->set_references(1);
+    return symbol;
+  }
+
+  Symbol &AddFunction(GeneratedFile &file, uint32_t kind,
+                      const std::string &name, const std::string &scope) {
+    auto &symbol = Add(file, kind, name, scope, true);
+    std::string signature = "(";
+    for (size_t i = m_random.Between(0, 4); i > 0; i--) {
+      signature += m_random.Pick(parameters);
+      signature += i > 1 ? ", " : "";
+    }
+    signature += ")";
+    std::string returnType =
+     kind == constructor_kind || kind == destructor_kind
+      ? ""
+      : m_random.Pick(value_types);
+    symbol.set_signature(signature);
+    symbol.set_return_type(returnType);
+    symbol.set_type(returnType + (returnType.empty() ? "" : " ") + signature);
+    return symbol;
+  }
+
+  Symbol &AddVariable(GeneratedFile &file, uint32_t kind,
+                      const std::string &name, const std::string &scope) {
+    auto &symbol = Add(file, kind, name, scope, false);
+    symbol.set_type(m_random.Pick(value_types));
+    return symbol;
+  }
+
+  // Adds a class deriving from `base`, if not null, with its members and
+  // nested classes. Returns false if the index is full.
+  bool AddClass(GeneratedFile &file, const std::string &scope,
+                const std::string &name, const GeneratedClass *base,
+                size_t nesting) {
+    if (Full()) {
+      return false;
+    }
+    auto &symbol = Add(file, m_random.Chance(0.3) ? struct_kind : class_kind,
+                       name, scope, false);
+    if (m_random.Chance(0.15)) {
+      symbol.mutable_info()->set_properties(generic_property);
+    } else if (m_random.Chance(0.03)) {
+      symbol.mutable_info()->set_properties(template_specialization_property);
+      symbol.set_template_specialization_args("<" + CamelCase(1) + " *>");
+    }
+
+    GeneratedClass res{symbol.id(), {}};
+    auto members = scope + name + "::";
+    if (base) {
+      m_index.relations[0][base->id].push_back(res.id);
+      for (auto &method : base->virtuals) {
+        if (Full()) {
+          return false;
+        }
+        if (m_random.Chance(0.5)) {
+          auto &overrider =
+           AddFunction(file, method_kind, method.first, members);
+          m_index.relations[1][method.second].push_back(overrider.id());
+          res.virtuals.emplace_back(method.first, overrider.id());
+        }
+      }
+    }
+
+    if (Full()) {
+      return false;
+    }
+    AddFunction(file, constructor_kind, name, members);
+    if (!Full() && m_random.Chance(0.5)) {
+      AddFunction(file, destructor_kind, "~" + name, members);
+    }
+    for (size_t i = m_random.Between(2, 25); i > 0 && !Full(); i--) {
+      auto method = MethodName();
+      if (m_random.Chance(0.1)) {
+        AddFunction(file, static_method_kind, method, members);
+      } else {
+        auto &symbol = AddFunction(file, method_kind, method, members);
+        if (m_random.Chance(0.2)) {
+          res.virtuals.emplace_back(method, symbol.id());
+        }
+      }
+    }
+    for (size_t i = m_random.Between(0, 10); i > 0 && !Full(); i--) {
+      AddVariable(file, field_kind, CamelCase(m_random.Between(1, 2)),
+                  members);
+    }
+    if (nesting < max_class_nesting && m_random.Chance(0.1) &&
+        !AddClass(file, members, CamelCase(2), nullptr, nesting + 1)) {
+      return false;
+    }
+
+    if (nesting == 0) {
+      m_classes.push_back(std::move(res));
+    }
+    return !Full();
+  }
+
+  void AddNamespaces() {
+    m_namespaces = {{"llvm::", "llvm", "", 1},
+                    {"clang::", "clang", "", 1},
+                    {"lldb_private::", "lldb", "", 1},
+                    {"mlir::", "mlir", "", 1},
+                    {"", "llvm", "", 0}};
+    std::set<std::string> scopes;
+    for (auto count = 20 + m_shape.symbols / 5000;
+         m_namespaces.size() < count;) {
+      auto parent = m_namespaces[m_random.Below(m_namespaces.size())];
+      std::string name = m_random.Pick(namespace_names);
+      auto scope = parent.scope + name + "::";
+      if (parent.depth < max_namespace_depth && scopes.insert(scope).second) {
+        m_namespaces.push_back(
+         {scope, parent.project, parent.dir + "/" + name, parent.depth + 1});
+      }
+    }
+  }
+
+  GeneratedFile NewFile(const std::string &name, bool test) {
+    auto &ns = m_namespaces[m_random.Below(m_namespaces.size())];
+    auto dir = ns.dir.empty() ? "/Support" : ns.dir;
+    GeneratedFile file{&ns, name,
+                       ns.project + "/include/" + ns.project + dir + "/" +
+                        name + ".h",
+                       ns.project + (test ? "/unittests" : "/lib") + dir +
+                        "/" + name + (test ? "Test.cpp" : ".cpp"),
+                       1};
+    m_paths.push_back(file.header);
+    m_paths.push_back(file.source);
+    return file;
+  }
+
+  // Adds the symbols of a header and its source file. Returns false if the
+  // index is full.
+  bool AddFile() {
+    auto test = m_random.Chance(0.05);
+    auto file = NewFile(CamelCase(m_random.Between(1, 2)), test);
+    auto &scope = file.ns->scope;
+
+    if (test) {
+      // gtest fixtures, each overriding testing::Test::TestBody
+      for (size_t i = m_random.Between(1, 15); i > 0 && !Full(); i--) {
+        auto name = file.name + "Test_" + MethodName() + "_Test";
+        auto &fixture = Add(file, class_kind, name, scope, true);
+        fixture.mutable_info()->set_properties(unit_test_property);
+        fixture.set_flags(0);
+        m_index.relations[0][m_testClass.id].push_back(fixture.id());
+        if (!Full()) {
+          auto &body =
+           AddFunction(file, method_kind, "TestBody", scope + name + "::");
+          body.set_flags(0);
+          m_index.relations[1][m_testClass.virtuals[0].second].push_back(
+           body.id());
+        }
+      }
+      return !Full();
+    }
+
+    for (size_t i = m_random.Between(0, 3); i > 0; i--) {
+      const GeneratedClass *base = nullptr;
+      if (!m_classes.empty() && m_random.Chance(0.6)) {
+        // Mostly one of the first classes
+        auto unit = m_random.Unit();
+        base = &m_classes[(size_t)(unit * unit * unit * unit *
+                                   (double)m_classes.size())];
+      }
+      if (!AddClass(file, scope, CamelCase(m_random.Between(1, 3)), base,
+                    0)) {
+        return false;
+      }
+    }
+    for (size_t i = m_random.Between(0, 8); i > 0 && !Full(); i--) {
+      AddFunction(file, function_kind, MethodName(), scope);
+    }
+    if (!Full() && m_random.Chance(0.3)) {
+      auto name = CamelCase(1) + "Kind";
+      Add(file, enum_kind, name, scope, false);
+      for (size_t i = m_random.Between(2, 30); i > 0 && !Full(); i--) {
+        AddVariable(file, enum_constant_kind, CamelCase(m_random.Between(1, 2)),
+                    scope + name + "::");
+      }
+    }
+    for (size_t i = m_random.Between(0, 2); i > 0 && !Full(); i--) {
+      AddVariable(file, variable_kind, "Default" + CamelCase(1), scope);
+    }
+    if (!Full() && m_random.Chance(0.2)) {
+      // A header guard
+      auto name = file.ns->project + "_" + file.name + "_H";
+      std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+      Add(file, macro_kind, name, "", false);
+    }
+    return !Full();
+  }
+
+  // Gives every symbol its declaration and definition, and a number of
+  // references that decreases with its rank in a random order, from
+  // `max_refs` for the most used symbol down to a handful
+  void AddRefs() {
+    std::vector<size_t> ranks(m_index.symbols.size());
+    for (size_t i = 0; i < ranks.size(); i++) {
+      ranks[i] = i;
+    }
+    for (size_t i = ranks.size(); i > 1; i--) {
+      std::swap(ranks[i - 1], ranks[m_random.Below(i)]);
+    }
+
+    auto mostRefs = std::min(max_refs, std::max<size_t>(1, ranks.size() / 10));
+    for (size_t i = 0; i < m_index.symbols.size(); i++) {
+      auto &symbol = m_index.symbols[i];
+      auto &refs = m_index.refs[symbol.id()];
+      auto count = mostRefs / (ranks[i] + 1) + m_random.Below(4);
+      refs.reserve(count + 2);
+
+      refs.emplace_back();
+      *refs.back().mutable_location() = symbol.canonical_declaration();
+      refs.back().set_kind(declaration_ref | spelled_ref);
+      if (symbol.definition().file_path() !=
+          symbol.canonical_declaration().file_path()) {
+        refs.emplace_back();
+        *refs.back().mutable_location() = symbol.definition();
+        refs.back().set_kind(declaration_ref | definition_ref | spelled_ref);
+      }
+
+      for (size_t j = 0; j < count; j++) {
+        refs.emplace_back();
+        SetLocation(*refs.back().mutable_location(),
+                    m_paths[m_random.Below(m_paths.size())],
+                    (uint32_t)m_random.Between(1, 5000), symbol.name().size());
+        // Some references are implicit, such as calls to constructors
+        refs.back().set_kind(m_random.Chance(0.9) ? reference_ref | spelled_ref
+                                                  : reference_ref);
+      }
+      symbol.set_references((int32_t)count);
+    }
+  }
+
+public:
+  explicit LlvmIndexGenerator(const LlvmIndexShape &shape)
+    : m_shape(shape), m_random(shape.seed) {}
+
+  FakeIndex Generate() {
+    while (m_text.size() < 2 * max_documentation_size) {
+      m_text += m_random.Chance(0.5) ? m_random.Pick(verbs)
+                                     : m_random.Pick(nouns);
+      m_text += m_random.Chance(0.1) ? ".\n" : " ";
+    }
+    AddNamespaces();
+
+    // Test files need testing::Test::TestBody
+    if (m_shape.symbols >= 2) {
+      GeneratedFile file{
+       &m_namespaces[0], "gtest",
+       "third-party/unittest/googletest/include/gtest/gtest.h",
+       "third-party/unittest/googletest/src/gtest.cc", 1};
+      m_paths.push_back(file.header);
+      m_paths.push_back(file.source);
+      m_testClass.id = Add(file, class_kind, "Test", "testing::", false).id();
+      auto &body =
+       AddFunction(file, method_kind, "TestBody", "testing::Test::");
+      m_testClass.virtuals.emplace_back("TestBody", body.id());
+      while (AddFile()) {
+      }
+    }
+
+    AddRefs();
+    return std::move(m_index);
+  }
+};
+
+FakeIndex GenerateLlvmIndex(const LlvmIndexShape &shape) {
+  return LlvmIndexGenerator(shape).Generate();
+}
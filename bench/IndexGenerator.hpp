@@ -0,0 +1,44 @@
+#ifndef INDEXGENERATOR_HPP
+#define INDEXGENERATOR_HPP
+#include "FakeIndex.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Shape of a generated index
+struct IndexShape {
+  size_t symbols = 100000;
+  // Symbols are spread evenly over this many namespaces, `ns0::` onwards
+  size_t scopes = 100;
+  size_t refsPerSymbol = 8;
+  size_t documentationSize = 200;
+  // Symbols are grouped in classes of this size, whose first symbol is a base
+  // of the others and is overridden by them
+  size_t classSize = 10;
+};
+
+// Generates an index of functions named `symbol0` onwards. The same shape
+// always gives the same index.
+FakeIndex GenerateIndex(const IndexShape &shape);
+
+// Shape of an index resembling clangd's index of LLVM, which has a few million
+// symbols
+struct LlvmIndexShape {
+  size_t symbols = 1000000;
+  uint64_t seed = 1;
+};
+
+// Generates an index of classes, methods, fields, functions, enums, variables
+// and macros in nested namespaces, with the skew of a real codebase: a few
+// symbols have up to 10^5 references and most have a handful, a few classes
+// have thousands of subclasses and documentation is mostly short but
+// sometimes pages long. Every kind of reference is present, so that the
+// `filter` of Refs requests matters. The same shape always gives the same
+// index, on any platform.
+FakeIndex GenerateLlvmIndex(const LlvmIndexShape &shape);
+
+// Id of the `i`-th generated symbol
+std::string GeneratedSymbolId(size_t i);
+
+#endif
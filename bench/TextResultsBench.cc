@@ -0,0 +1,27 @@
+#include "BenchDatabase.hpp"
+#include "BenchModules.hpp"
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+constexpr size_t text_rows = 1000000;
+
+// Hands 1M strings of state.range(0) bytes to SQLite, copying them if
+// state.range(1) is 0 and sharing them if it is 1. count() doesn't look at
+// the text, so the time is spent producing the values.
+static void BM_TextResults(benchmark::State &state) {
+  BenchDatabase db;
+  db.Exec("CREATE VIRTUAL TABLE t USING bench_texts(" +
+          std::to_string(text_rows) + ", " + std::to_string(state.range(0)) +
+          ", " + std::to_string(state.range(1)) + ")");
+
+  for (auto _ : state) {
+    db.Run("SELECT count(Doc) FROM t");
+  }
+
+  state.SetItemsProcessed(state.iterations() * text_rows);
+}
+BENCHMARK(BM_TextResults)
+ ->ArgNames({"size", "share"})
+ ->ArgsProduct({{16, 256, 1024, 1536, 2048, 3072, 4096}, {0, 1}})
+ ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,81 @@
+#include "TextsModule.hpp"
+#include "BenchModules.hpp"
+#include "sqlite3ext.h"
+SQLITE_EXTENSION_INIT3
+#include "VirtualTable.hpp"
+#include "VirtualTableCursor.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Distinct rows that are cycled through, like replies that come and go
+constexpr size_t texts_distinct_rows = 64;
+
+class TextsCursor final : public VirtualTableCursor {
+  const std::vector<std::shared_ptr<const std::string>> &m_texts;
+  size_t m_rows;
+  bool m_share;
+  size_t m_row = 0;
+
+public:
+  TextsCursor(const std::vector<std::shared_ptr<const std::string>> &texts,
+              size_t rows, bool share)
+    : m_texts(texts), m_rows(rows), m_share(share) {}
+
+  int Filter(int idxNum, const char *idxStr, int argc,
+             sqlite3_value **argv) override {
+    m_row = 0;
+    return SQLITE_OK;
+  }
+  int Next() override {
+    m_row++;
+    return SQLITE_OK;
+  }
+  int Eof() override { return m_row >= m_rows; }
+  int Column(sqlite3_context *ctx, int idxCol) override {
+    auto &text = m_texts[m_row % m_texts.size()];
+    if (m_share) {
+      ResultText(ctx, *text, text);
+    } else {
+      ResultText(ctx, *text);
+    }
+    return SQLITE_OK;
+  }
+  sqlite3_int64 RowId() override { return m_row; }
+};
+
+class TextsTable final : public VirtualTable {
+  std::vector<std::shared_ptr<const std::string>> m_texts;
+  size_t m_rows;
+  bool m_share;
+
+public:
+  TextsTable(sqlite3 *db, size_t rows, size_t size, bool share)
+    : m_rows(rows), m_share(share) {
+    for (size_t i = 0; i < texts_distinct_rows; i++) {
+      m_texts.push_back(
+       std::make_shared<const std::string>(size, (char)('a' + i % 26)));
+    }
+    if (sqlite3_declare_vtab(db, "CREATE TABLE vtable(Doc TEXT)") !=
+        SQLITE_OK) {
+      throw std::runtime_error(sqlite3_errmsg(db));
+    }
+  }
+
+  int BestIndex(sqlite3_index_info *info) override { return SQLITE_OK; }
+  std::unique_ptr<VirtualTableCursor> Open() override {
+    return std::make_unique<TextsCursor>(m_texts, m_rows, m_share);
+  }
+};
+
+std::unique_ptr<VirtualTable> TextsModule::Create(sqlite3 *db, int argc,
+                                                  const char *const *argv) {
+  if (argc != 6) {
+    throw std::runtime_error("Expected the number of rows, size and sharing");
+  }
+  return std::make_unique<TextsTable>(db, std::strtoull(argv[3], nullptr, 10),
+                                      std::strtoull(argv[4], nullptr, 10),
+                                      std::atoi(argv[5]) != 0);
+}
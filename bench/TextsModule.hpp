@@ -0,0 +1,19 @@
+#ifndef TEXTSMODULE_HPP
+#define TEXTSMODULE_HPP
+#include "Module.hpp"
+
+// Module of tables with a single `Doc TEXT` column, used to measure what it
+// costs to hand text results to SQLite. Created with
+//
+//   CREATE VIRTUAL TABLE t USING bench_texts(rows, size, share)
+//
+// where every row holds a string of `size` bytes, which is shared with SQLite
+// when `share` is 1 and copied otherwise, whatever its size, so that both can
+// be compared.
+class TextsModule : public Module {
+public:
+  std::unique_ptr<VirtualTable> Create(sqlite3 *db, int argc,
+                                       const char *const *argv) override;
+};
+
+#endif
@@ -0,0 +1,82 @@
+-- Queries run by clangql_corpus against the fake index server, each with the
+-- budget it has to stay within. The tables are created as in the README.
+-- Budgets are given as `key=value` pairs: `rpcs` and `bytes` are the most
+-- calls and reply bytes a query may take, `rows` the number of rows it must
+-- return. A query with a LIMIT also gets a byte budget, to check that the
+-- limit reaches the server.
+--
+-- Joins also give their expected plan, one `-- plan:` line for each line of
+-- EXPLAIN QUERY PLAN, which must start with it. This checks which table the
+-- cost model puts on the outside, and what each table is asked. Queries are
+-- all planned before the first one runs, so that no plan depends on the scans
+-- of the queries before it.
+
+-- exact name
+-- budget: rpcs=1 rows=5
+SELECT Name, Scope, DefPath FROM llvm_symbols WHERE Name = 'Foo';
+
+-- scope listing
+-- budget: rpcs=1 rows=5
+SELECT Name FROM llvm_symbols WHERE Scope = 'std::';
+
+-- subclass join
+-- budget: rpcs=3 rows=10
+-- plan: SCAN superclass VIRTUAL TABLE INDEX 0:FuzzyFind(name=eq)
+-- plan: SCAN rel VIRTUAL TABLE INDEX 0:Relations(subject=eq)
+-- plan: SCAN subclass VIRTUAL TABLE INDEX 0:Lookup(id=eq)
+SELECT subclass.Name, subclass.Scope, subclass.DefPath
+FROM llvm_symbols AS superclass
+INNER JOIN llvm_base_of AS rel ON rel.Subject = superclass.Id
+INNER JOIN llvm_symbols AS subclass ON subclass.Id = rel.Object
+WHERE superclass.Name = 'MCAsmInfo';
+
+-- std declarations via refs
+-- budget: rpcs=6 rows=5
+-- plan: SCAN decl VIRTUAL TABLE INDEX 0:FuzzyFind(scope=eq)
+-- plan: SCAN ref VIRTUAL TABLE INDEX 0:Refs(id=eq,declaration=eq)
+SELECT decl.Name FROM llvm_symbols AS decl
+INNER JOIN llvm_refs AS ref ON ref.SymbolId = decl.Id
+WHERE decl.Scope = 'std::' AND ref.Declaration = 1;
+
+-- fuzzy name with a limit
+-- budget: rpcs=1 bytes=500 rows=3
+SELECT Name FROM llvm_symbols WHERE Name LIKE 'MCAsmInfo' LIMIT 3;
+
+-- subclasses of 1000 classes
+-- budget: rpcs=1001 rows=500
+-- plan: SCAN base VIRTUAL TABLE INDEX 0:FuzzyFind(scope=eq)
+-- plan: SCAN rel VIRTUAL TABLE INDEX 0:Relations(subject=eq)
+SELECT base.Name, rel.Object FROM llvm_symbols AS base
+INNER JOIN llvm_base_of AS rel ON rel.Subject = base.Id
+WHERE base.Scope = 'corpus::';
+
+-- same subclasses, probed twice
+-- budget: rpcs=1001 rows=1000
+SELECT base.Name, rel.Object FROM llvm_symbols AS base
+CROSS JOIN (VALUES (1), (2)) AS twice
+CROSS JOIN llvm_base_of AS rel ON rel.Subject = base.Id
+WHERE base.Scope = 'corpus::';
+
+-- all references of a symbol
+-- budget: rpcs=2 bytes=40000 rows=1000
+SELECT ref.* FROM llvm_symbols AS sym
+INNER JOIN llvm_refs AS ref ON ref.SymbolId = sym.Id
+WHERE sym.Name = 'CorpusRefs';
+
+-- plain references of a symbol
+-- Half of the references have the reference kind. Filtering them here rather
+-- than on the server would receive as many bytes as the query above.
+-- budget: rpcs=2 bytes=20000 rows=500
+-- plan: SCAN sym VIRTUAL TABLE INDEX 0:FuzzyFind(name=eq)
+-- plan: SCAN ref VIRTUAL TABLE INDEX 0:Refs(id=eq,reference=eq)
+SELECT ref.* FROM llvm_symbols AS sym
+INNER JOIN llvm_refs AS ref ON ref.SymbolId = sym.Id
+WHERE sym.Name = 'CorpusRefs' AND ref.Reference = 1;
+
+-- exact name after a failed search
+-- The first search of this name fails after 3 of its 8 results, so the
+-- second one has to go to the server again rather than to the name cache.
+-- budget: rpcs=2 rows=11
+SELECT Name FROM llvm_symbols WHERE Name = 'CorpusFlaky'
+UNION ALL
+SELECT Name FROM llvm_symbols WHERE Name = 'CorpusFlaky';
@@ -0,0 +1,507 @@
+#include "AsyncEngine.hpp"
+#include "Trace.hpp"
+
+#include <functional>
+#include <utility>
+
+using namespace clang::clangd::remote;
+using clang::clangd::remote::v1::SymbolIndex;
+
+// Calls started in the background that nobody picked up are cancelled, oldest
+// first, past this number
+constexpr size_t max_pending_calls = 256;
+
+// Number of announced keys remembered by the engine
+constexpr size_t max_announced_keys = 4096;
+
+// Bytes of results a call started in the background may buffer before it is
+// picked up. Past this, the call is cancelled and its results thrown away, and
+// picking it up makes a regular call instead.
+constexpr size_t max_pending_bytes = 1 << 18;
+
+// Results of a call, filled on the engine thread and consumed by a cursor
+template <typename T> struct AsyncResults {
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<T> items;
+  // Whether the server is done sending results
+  bool done = false;
+  bool hasMore = false;
+  // Whether the server sent its final result
+  bool ok = false;
+  // Bytes of `items` received before the call was picked up
+  size_t pendingBytes = 0;
+  // Whether a cursor is reading the results
+  bool taken = false;
+  // Whether the call was cancelled for buffering too much before being
+  // picked up
+  bool overflowed = false;
+};
+
+class AsyncCallBase {
+public:
+  virtual ~AsyncCallBase() = default;
+
+  // Starts the call, its completions are reported on `cq` with `this` as tag
+  virtual void Begin(SymbolIndex::Stub &stub, grpc::CompletionQueue *cq) = 0;
+  // Handles the completion of the last operation, returns false once the call
+  // is over
+  virtual bool Proceed(bool ok) = 0;
+  virtual void Cancel() = 0;
+  virtual RpcCounters &Counters() = 0;
+};
+
+template <typename Request, typename Reply, typename T>
+class AsyncCall final : public AsyncCallBase {
+public:
+  using Prepare = std::unique_ptr<grpc::ClientAsyncReaderInterface<Reply>> (
+   SymbolIndex::StubInterface::*)(grpc::ClientContext *, const Request &,
+                                  grpc::CompletionQueue *);
+  using OnResult = std::function<void(const T &)>;
+
+private:
+  enum State { Starting, Reading, Finishing };
+
+  Prepare m_prepare;
+  Request m_req;
+  OnResult m_onResult;
+  std::shared_ptr<AsyncResults<T>> m_results;
+  bool m_keepResults;
+  RpcCounters &m_counters;
+  // Created once the call starts, so that time spent queued is not counted
+  std::unique_ptr<CallRecorder> m_recorder;
+
+  grpc::ClientContext m_ctx;
+  std::unique_ptr<grpc::ClientAsyncReaderInterface<Reply>> m_reader;
+  Reply m_reply;
+  grpc::Status m_status;
+  State m_state = Starting;
+
+public:
+  AsyncCall(Prepare prepare, const Request &req, OnResult onResult,
+            bool keepResults, RpcCounters &counters)
+    : m_prepare(prepare), m_req(req), m_onResult(std::move(onResult)),
+      m_results(std::make_shared<AsyncResults<T>>()),
+      m_keepResults(keepResults), m_counters(counters) {}
+
+  const std::shared_ptr<AsyncResults<T>> &Results() { return m_results; }
+
+  void Begin(SymbolIndex::Stub &stub, grpc::CompletionQueue *cq) override {
+    m_recorder = std::make_unique<CallRecorder>(m_counters);
+    m_reader = (stub.*m_prepare)(&m_ctx, m_req, cq);
+    m_reader->StartCall(this);
+  }
+
+  bool Proceed(bool ok) override {
+    switch (m_state) {
+    case Starting:
+    case Reading:
+      if (ok && m_state == Reading) {
+        m_recorder->Message(m_reply.ByteSizeLong());
+      }
+      if (ok && m_state == Reading && m_reply.has_final_result()) {
+        std::lock_guard<std::mutex> lock(m_results->mutex);
+        m_results->hasMore = m_reply.final_result().has_more();
+        m_results->ok = true;
+      }
+      if (ok && m_state == Reading && m_reply.has_stream_result()) {
+        if (m_onResult) {
+          m_onResult(m_reply.stream_result());
+        }
+        if (m_keepResults) {
+          Keep();
+        }
+      }
+
+      if (ok) {
+        m_state = Reading;
+        m_reader->Read(&m_reply, this);
+        return true;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(m_results->mutex);
+        m_results->done = true;
+        m_results->cond.notify_all();
+      }
+      m_recorder->Done();
+      m_state = Finishing;
+      m_reader->Finish(&m_status, this);
+      return true;
+
+    case Finishing:
+      m_recorder->Finish(m_status.ok(), m_status.error_code() ==
+                                         grpc::StatusCode::CANCELLED);
+      return false;
+    }
+    return false;
+  }
+
+  void Cancel() override { m_ctx.TryCancel(); }
+
+  RpcCounters &Counters() override { return m_counters; }
+
+private:
+  // Adds the result of `m_reply` to the results, unless they grew too large
+  // for a call nobody picked up
+  void Keep() {
+    std::lock_guard<std::mutex> lock(m_results->mutex);
+    auto &results = *m_results;
+    if (results.overflowed) {
+      m_counters.discardedMessages++;
+      m_counters.discardedBytes += m_reply.ByteSizeLong();
+      return;
+    }
+
+    if (!results.taken) {
+      results.pendingBytes += m_reply.stream_result().ByteSizeLong();
+      if (results.pendingBytes > max_pending_bytes) {
+        results.overflowed = true;
+        m_ctx.TryCancel();
+        m_counters.cancelled++;
+        m_counters.discardedMessages += results.items.size() + 1;
+        m_counters.discardedBytes += results.pendingBytes;
+        results.items.clear();
+        return;
+      }
+    }
+    results.items.emplace_back();
+    results.items.back().Swap(m_reply.mutable_stream_result());
+    results.cond.notify_all();
+  }
+};
+
+// Accounts for the results of a call that nobody is going to read, and
+// cancels the call if the server is not done yet
+template <typename T>
+static void drop_results(AsyncCallBase &call, void *ptr) {
+  auto &results = *static_cast<AsyncResults<T> *>(ptr);
+  auto &counters = call.Counters();
+  std::lock_guard<std::mutex> lock(results.mutex);
+  if (!results.done && !results.overflowed) {
+    call.Cancel();
+    counters.cancelled++;
+  }
+  for (auto &item : results.items) {
+    counters.discardedMessages++;
+    counters.discardedBytes += item.ByteSizeLong();
+  }
+  results.items.clear();
+}
+
+// Yields the results of a call running on the engine as they arrive
+template <typename T>
+class AsyncResultStream final : public IResultStream<T> {
+  std::shared_ptr<AsyncCallBase> m_call;
+  std::shared_ptr<AsyncResults<T>> m_results;
+  T m_current;
+
+public:
+  AsyncResultStream(std::shared_ptr<AsyncCallBase> call,
+                    std::shared_ptr<AsyncResults<T>> results)
+    : m_call(std::move(call)), m_results(std::move(results)) {}
+
+  ~AsyncResultStream() override {
+    drop_results<T>(*m_call, m_results.get());
+  }
+
+  const T &Current() override { return m_current; }
+
+  bool Next() override {
+    std::unique_lock<std::mutex> lock(m_results->mutex);
+    auto ready = [&] { return !m_results->items.empty() || m_results->done; };
+    if (!ready()) {
+      TraceSpan span("wait", "async results");
+      m_results->cond.wait(lock, ready);
+    }
+    if (m_results->items.empty()) {
+      return false;
+    }
+
+    m_current.Swap(&m_results->items.front());
+    m_results->items.pop_front();
+    return true;
+  }
+
+  void Cancel() override { m_call->Cancel(); }
+
+  bool HasMore() override {
+    std::lock_guard<std::mutex> lock(m_results->mutex);
+    return m_results->hasMore;
+  }
+
+  bool Ok() override {
+    std::lock_guard<std::mutex> lock(m_results->mutex);
+    return m_results->ok;
+  }
+
+  void MoveCurrent(T &dest) override { dest.Swap(&m_current); }
+};
+
+using RefsCall = AsyncCall<RefsRequest, RefsReply, Ref>;
+using RelationsCall = AsyncCall<RelationsRequest, RelationsReply, Relation>;
+using LookupCall = AsyncCall<LookupRequest, LookupReply, Symbol>;
+
+static std::string refs_key(const RefsRequest &req) {
+  return "R" + req.SerializeAsString();
+}
+
+static std::string relations_key(const RelationsRequest &req) {
+  return "L" + req.SerializeAsString();
+}
+
+AsyncEngine::AsyncEngine(std::shared_ptr<grpc::Channel> channel,
+                         std::shared_ptr<SymbolCache> cache,
+                         size_t maxInFlight)
+  : m_stub(SymbolIndex::NewStub(channel)), m_cache(std::move(cache)),
+    m_maxInFlight(maxInFlight) {
+  m_thread = std::thread([this] { Run(); });
+}
+
+AsyncEngine::~AsyncEngine() {
+  {
+    // Operations can't be added to the queue once it is shut down, so wait
+    // for the calls to wind down first
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    m_queued.clear();
+    for (auto &entry : m_running) {
+      entry.second->Cancel();
+    }
+    m_idle.wait(lock, [&] { return m_running.empty(); });
+  }
+
+  m_cq.Shutdown();
+  m_thread.join();
+}
+
+void AsyncEngine::Run() {
+  void *tag;
+  bool ok;
+  while (m_cq.Next(&tag, &ok)) {
+    auto call = static_cast<AsyncCallBase *>(tag);
+    if (call->Proceed(ok)) {
+      continue;
+    }
+
+    std::shared_ptr<AsyncCallBase> done;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_running.find(call);
+    done = std::move(it->second);
+    m_running.erase(it);
+    StartQueued();
+    if (m_running.empty()) {
+      m_idle.notify_all();
+    }
+  }
+}
+
+void AsyncEngine::Enqueue(std::shared_ptr<AsyncCallBase> call) {
+  m_queued.push_back(std::move(call));
+  StartQueued();
+}
+
+void AsyncEngine::StartQueued() {
+  while (!m_stopping && !m_queued.empty() &&
+         m_running.size() < m_maxInFlight) {
+    auto call = std::move(m_queued.front());
+    m_queued.pop_front();
+
+    auto ptr = call.get();
+    m_running[ptr] = std::move(call);
+    ptr->Begin(*m_stub, &m_cq);
+  }
+}
+
+void AsyncEngine::AddPending(std::string key, Pending pending) {
+  while (m_pending.size() >= max_pending_calls) {
+    auto it = m_pending.find(m_pendingOrder.front());
+    m_pendingOrder.pop_front();
+    if (it == m_pending.end()) {
+      continue;
+    }
+
+    auto &evicted = it->second;
+    evicted.drop(*evicted.call, evicted.results.get());
+    for (auto q = m_queued.begin(); q != m_queued.end(); ++q) {
+      if (*q == evicted.call) {
+        m_queued.erase(q);
+        break;
+      }
+    }
+    m_pending.erase(it);
+  }
+
+  // Keys of calls that were picked up are only removed lazily
+  if (m_pendingOrder.size() >= 2 * max_pending_calls) {
+    std::deque<std::string> order;
+    for (auto &k : m_pendingOrder) {
+      if (m_pending.count(k)) {
+        order.push_back(std::move(k));
+      }
+    }
+    m_pendingOrder = std::move(order);
+  }
+
+  m_pendingOrder.push_back(key);
+  m_pending.emplace(std::move(key), std::move(pending));
+}
+
+AsyncEngine::Pending AsyncEngine::TakePending(const std::string &key) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_pending.find(key);
+  if (it == m_pending.end()) {
+    return {};
+  }
+
+  auto pending = std::move(it->second);
+  m_pending.erase(it);
+  return pending;
+}
+
+void AsyncEngine::Start(const RefsRequest &req, RpcCounters &counters) {
+  auto key = refs_key(req);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_stopping || m_pending.count(key)) {
+    return;
+  }
+
+  auto call = std::make_shared<RefsCall>(
+   &SymbolIndex::StubInterface::PrepareAsyncRefs, req, nullptr, true,
+   counters);
+  AddPending(std::move(key), {call, call->Results(), &drop_results<Ref>});
+  Enqueue(std::move(call));
+}
+
+void AsyncEngine::Start(const RelationsRequest &req,
+                        RpcCounters &counters) {
+  auto key = relations_key(req);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_stopping || m_pending.count(key)) {
+    return;
+  }
+
+  auto cache = m_cache;
+  auto call = std::make_shared<RelationsCall>(
+   &SymbolIndex::StubInterface::PrepareAsyncRelations, req,
+   [cache](const Relation &rel) { cache->Insert(rel.object()); }, true,
+   counters);
+  AddPending(std::move(key),
+             {call, call->Results(), &drop_results<Relation>});
+  Enqueue(std::move(call));
+}
+
+// Returns a stream of the results of a call that was picked up, or nullptr if
+// there is no call or it buffered too much and was cancelled
+template <typename T>
+static std::unique_ptr<IResultStream<T>>
+take_results(std::shared_ptr<AsyncCallBase> call,
+             std::shared_ptr<void> pending) {
+  if (!call) {
+    return nullptr;
+  }
+
+  auto results = std::static_pointer_cast<AsyncResults<T>>(pending);
+  {
+    std::lock_guard<std::mutex> lock(results->mutex);
+    if (results->overflowed) {
+      return nullptr;
+    }
+    results->taken = true;
+  }
+  return std::make_unique<AsyncResultStream<T>>(std::move(call),
+                                                std::move(results));
+}
+
+std::unique_ptr<IResultStream<Ref>> AsyncEngine::Take(const RefsRequest &req) {
+  auto pending = TakePending(refs_key(req));
+  return take_results<Ref>(std::move(pending.call),
+                           std::move(pending.results));
+}
+
+std::unique_ptr<IResultStream<Relation>>
+AsyncEngine::Take(const RelationsRequest &req) {
+  auto pending = TakePending(relations_key(req));
+  return take_results<Relation>(std::move(pending.call),
+                                std::move(pending.results));
+}
+
+void AsyncEngine::Prefetch(const LookupRequest &req, RpcCounters &counters) {
+  auto cache = m_cache;
+  auto call = std::make_shared<LookupCall>(
+   &SymbolIndex::StubInterface::PrepareAsyncLookup, req,
+   [cache](const Symbol &symbol) { cache->Insert(symbol); }, false,
+   counters);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_stopping) {
+    return;
+  }
+
+  // Forget about lookups that are over
+  for (auto it = m_prefetching.begin(); it != m_prefetching.end();) {
+    auto results = std::static_pointer_cast<AsyncResults<Symbol>>(it->second);
+    std::lock_guard<std::mutex> resultsLock(results->mutex);
+    it = results->done ? m_prefetching.erase(it) : std::next(it);
+  }
+
+  for (auto &id : req.ids()) {
+    m_prefetching[id] = call->Results();
+  }
+  Enqueue(std::move(call));
+}
+
+void AsyncEngine::WaitForSymbol(const std::string &id) {
+  std::shared_ptr<AsyncResults<Symbol>> results;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_prefetching.find(id);
+    if (it == m_prefetching.end()) {
+      return;
+    }
+    results = std::static_pointer_cast<AsyncResults<Symbol>>(it->second);
+    m_prefetching.erase(it);
+  }
+
+  TraceSpan span("wait", "symbol prefetch");
+  std::unique_lock<std::mutex> lock(results->mutex);
+  results->cond.wait(lock, [&] { return results->done; });
+}
+
+bool AsyncEngine::IsPrefetching(const std::string &id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_prefetching.count(id) != 0;
+}
+
+void AsyncEngine::Announce(const std::string &key) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_announced.size() == max_announced_keys) {
+    auto it = m_seqOf.find(m_announced.front());
+    if (it != m_seqOf.end() && it->second == m_firstSeq) {
+      m_seqOf.erase(it);
+    }
+    m_announced.pop_front();
+    m_firstSeq++;
+  }
+
+  m_seqOf[key] = m_firstSeq + m_announced.size();
+  m_announced.push_back(key);
+}
+
+std::vector<std::string> AsyncEngine::Upcoming(const std::string &key,
+                                               size_t count) {
+  std::vector<std::string> res;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_seqOf.find(key);
+  if (it == m_seqOf.end()) {
+    return res;
+  }
+
+  for (auto i = it->second - m_firstSeq + 1;
+       i < m_announced.size() && res.size() < count; i++) {
+    if (m_announced[i] != key) {
+      res.push_back(m_announced[i]);
+    }
+  }
+  return res;
+}
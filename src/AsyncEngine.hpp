@@ -0,0 +1,166 @@
+#ifndef ASYNCENGINE_HPP
+#define ASYNCENGINE_HPP
+#include "IResultStream.hpp"
+#include "Service.grpc.pb.h"
+#include "Statistics.hpp"
+#include "SymbolCache.hpp"
+#include <grpcpp/grpcpp.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class AsyncCallBase;
+
+// Keeps many calls to the SymbolIndex service in flight at the same time,
+// using the asynchronous stub and a completion queue serviced by a background
+// thread. There is one engine for each server.
+//
+// Calls are identified by their request: cursors start calls for results they
+// are going to need soon, and pick them up later with an identical request.
+//
+// To know what is going to be needed soon, cursors reading ahead announce the
+// join keys they are about to produce. Cursors on the inner side of a join,
+// when probed with one of those keys, start calls for the keys that follow it.
+class AsyncEngine {
+public:
+  AsyncEngine(std::shared_ptr<grpc::Channel> channel,
+              std::shared_ptr<SymbolCache> cache, size_t maxInFlight);
+  ~AsyncEngine();
+
+  // Starts a call in the background, unless an identical one is already
+  // waiting to be picked up. The call is accounted for in `counters`.
+  void Start(const clang::clangd::remote::RefsRequest &req,
+             RpcCounters &counters);
+  void Start(const clang::clangd::remote::RelationsRequest &req,
+             RpcCounters &counters);
+
+  // Picks up the results of a call started earlier with an identical request,
+  // or returns nullptr, which is also the case if the call was cancelled for
+  // buffering too many results. Results are yielded as soon as they arrive.
+  std::unique_ptr<IResultStream<clang::clangd::remote::Ref>>
+  Take(const clang::clangd::remote::RefsRequest &req);
+  std::unique_ptr<IResultStream<clang::clangd::remote::Relation>>
+  Take(const clang::clangd::remote::RelationsRequest &req);
+
+  // Looks up symbols in the background, only to store them in the cache
+  void Prefetch(const clang::clangd::remote::LookupRequest &req,
+                RpcCounters &counters);
+  // Returns once a background lookup of `id` is over, if there is one
+  void WaitForSymbol(const std::string &id);
+  bool IsPrefetching(const std::string &id);
+
+  // Records that a cursor is about to produce `key`
+  void Announce(const std::string &key);
+  // Returns up to `count` keys that were announced right after `key`
+  std::vector<std::string> Upcoming(const std::string &key, size_t count);
+
+private:
+  struct Pending {
+    std::shared_ptr<AsyncCallBase> call;
+    std::shared_ptr<void> results;
+    // Accounts for results that will never be read
+    void (*drop)(AsyncCallBase &call, void *results);
+  };
+
+  std::unique_ptr<clang::clangd::remote::v1::SymbolIndex::Stub> m_stub;
+  std::shared_ptr<SymbolCache> m_cache;
+  grpc::CompletionQueue m_cq;
+  std::thread m_thread;
+
+  std::mutex m_mutex;
+  std::condition_variable m_idle;
+  bool m_stopping = false;
+  size_t m_maxInFlight;
+  std::deque<std::shared_ptr<AsyncCallBase>> m_queued;
+  std::unordered_map<AsyncCallBase *, std::shared_ptr<AsyncCallBase>>
+   m_running;
+
+  // Calls started with `Start` that nobody picked up yet, oldest first
+  std::unordered_map<std::string, Pending> m_pending;
+  std::deque<std::string> m_pendingOrder;
+  // Symbols being looked up by `Prefetch`
+  std::unordered_map<std::string, std::shared_ptr<void>> m_prefetching;
+
+  // The most recently announced keys, with their sequence numbers
+  std::deque<std::string> m_announced;
+  uint64_t m_firstSeq = 0;
+  std::unordered_map<std::string, uint64_t> m_seqOf;
+
+  void Run();
+  void Enqueue(std::shared_ptr<AsyncCallBase> call);
+  void StartQueued();
+  void AddPending(std::string key, Pending pending);
+  Pending TakePending(const std::string &key);
+};
+
+// Reads `depth` results ahead of the consumer, announcing the join key of each
+// result to the engine as soon as it has been read
+template <typename T> class LookaheadStream final : public IResultStream<T> {
+public:
+  using KeyFn = const std::string &(*)(const T &);
+
+private:
+  std::unique_ptr<IResultStream<T>> m_source;
+  AsyncEngine &m_engine;
+  KeyFn m_key;
+  size_t m_depth;
+  std::deque<T> m_buffer;
+  T m_current;
+  bool m_sourceDone = false;
+
+public:
+  LookaheadStream(std::unique_ptr<IResultStream<T>> source, AsyncEngine &engine,
+                  KeyFn key, size_t depth)
+    : m_source(std::move(source)), m_engine(engine), m_key(key),
+      m_depth(depth) {}
+
+  const T &Current() override { return m_current; }
+
+  bool Next() override {
+    while (!m_sourceDone && m_buffer.size() <= m_depth) {
+      if (!m_source->Next()) {
+        m_sourceDone = true;
+        break;
+      }
+      m_buffer.emplace_back();
+      m_source->MoveCurrent(m_buffer.back());
+      m_engine.Announce(m_key(m_buffer.back()));
+    }
+
+    if (m_buffer.empty()) {
+      return false;
+    }
+    m_current.Swap(&m_buffer.front());
+    m_buffer.pop_front();
+    return true;
+  }
+
+  void Cancel() override { m_source->Cancel(); }
+
+  bool HasMore() override { return m_source->HasMore(); }
+  bool Ok() override { return m_source->Ok(); }
+
+  void MoveCurrent(T &dest) override { dest.Swap(&m_current); }
+};
+
+// Wraps `stream` in a LookaheadStream, unless `depth` is 0
+template <typename T>
+std::unique_ptr<IResultStream<T>>
+WithLookahead(std::unique_ptr<IResultStream<T>> stream, AsyncEngine &engine,
+              typename LookaheadStream<T>::KeyFn key, size_t depth) {
+  if (depth == 0) {
+    return stream;
+  }
+  return std::make_unique<LookaheadStream<T>>(std::move(stream), engine, key,
+                                              depth);
+}
+
+#endif
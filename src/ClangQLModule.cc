@@ -1,27 +1,37 @@
 #include "ClangQLModule.hpp"
 SQLITE_EXTENSION_INIT3
+#include "AsyncEngine.hpp"
+#include "IndexBackend.hpp"
+#include "RecordReplay.hpp"
 #include "RefsTable.hpp"
 #include "RelationsTable.hpp"
+#include "Snapshot.hpp"
 #include "SymbolsTable.hpp"
+#include "TableOptions.hpp"
 #include <grpcpp/grpcpp.h>
 
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 
 using namespace clang::clangd::remote;
-using clang::clangd::remote::v1::SymbolIndex;
 
 static std::shared_ptr<grpc::Channel> get_channel(std::string addr) {
+  static std::mutex mutex;
   static std::unordered_map<std::string, std::shared_ptr<grpc::Channel>>
    channels;
 
+  std::lock_guard<std::mutex> lock(mutex);
+
   auto it = channels.find(addr);
   if (it != channels.end()) {
     return it->second;
   } else {
-    auto channel =
-     grpc::CreateChannel(addr, grpc::InsecureChannelCredentials());
+    auto channel = GetProxyChannel(addr);
+    if (!channel) {
+      channel = grpc::CreateChannel(addr, grpc::InsecureChannelCredentials());
+    }
 
     channels[addr] = channel;
 
@@ -29,25 +39,118 @@ static std::shared_ptr<grpc::Channel> get_channel(std::string addr) {
   }
 }
 
+constexpr const char snapshot_prefix[] = "snapshot:";
+
+std::shared_ptr<IndexBackend> GetIndexBackend(const std::string &addr) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::shared_ptr<IndexBackend>>
+   backends;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto it = backends.find(addr);
+  if (it != backends.end()) {
+    return it->second;
+  } else {
+    std::shared_ptr<IndexBackend> backend;
+    if (addr.rfind(snapshot_prefix, 0) == 0) {
+      backend = std::make_shared<SnapshotBackend>(
+       addr.substr(sizeof(snapshot_prefix) - 1));
+    } else {
+      backend = std::make_shared<RemoteIndexBackend>(get_channel(addr));
+    }
+
+    backends[addr] = backend;
+
+    return backend;
+  }
+}
+
+// Number of symbols kept around for each server
+constexpr size_t symbol_cache_capacity = 1 << 16;
+
+static std::shared_ptr<SymbolCache> get_cache(std::string addr) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::shared_ptr<SymbolCache>> caches;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto it = caches.find(addr);
+  if (it != caches.end()) {
+    return it->second;
+  } else {
+    auto cache = std::make_shared<SymbolCache>(symbol_cache_capacity);
+
+    caches[addr] = cache;
+
+    return cache;
+  }
+}
+
+// Number of background calls kept in flight for each server
+constexpr size_t async_max_in_flight = 32;
+
+static std::shared_ptr<AsyncEngine>
+get_engine(std::string addr, std::shared_ptr<grpc::Channel> channel,
+           std::shared_ptr<SymbolCache> cache) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::shared_ptr<AsyncEngine>> engines;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto it = engines.find(addr);
+  if (it != engines.end()) {
+    return it->second;
+  } else {
+    auto engine = std::make_shared<AsyncEngine>(channel, cache,
+                                                async_max_in_flight);
+
+    engines[addr] = engine;
+
+    return engine;
+  }
+}
+
+// Removes the quotes around a connection string, which SQLite keeps. They are
+// needed around the paths of `record:`, `replay:` and `snapshot:` connection
+// strings.
+static std::string dequote(std::string arg) {
+  if (arg.size() >= 2 && (arg[0] == '\'' || arg[0] == '"') &&
+      arg.back() == arg[0]) {
+    arg = arg.substr(1, arg.size() - 2);
+  }
+  return arg;
+}
+
 std::unique_ptr<VirtualTable> ClangQLModule::Create(sqlite3 *db, int argc,
                                                     const char *const *argv) {
-  if (argc != 5) {
+  if (argc < 5) {
     throw std::runtime_error("Invalid number of arguments for table creation");
   }
 
   auto table_type = std::string{argv[3]};
-  auto server_addr = std::string{argv[4]};
-  auto channel = get_channel(server_addr);
+  auto server_addr = dequote(argv[4]);
+  auto options = TableOptions::Parse(argc - 5, argv + 5);
+  auto stats = GetTableStats(argv[2], server_addr);
+  auto backend = GetIndexBackend(server_addr);
+  auto cache = get_cache(server_addr);
+  // The engine and its thread are only needed by tables reading ahead, and
+  // make their calls straight to the server
+  auto channel = backend->Channel();
+  auto engine = options.lookahead && channel
+                 ? get_engine(server_addr, channel, cache)
+                 : nullptr;
   if (table_type == "symbols") {
-    return std::make_unique<SymbolsTable>(db, SymbolIndex::NewStub(channel));
+    return std::make_unique<SymbolsTable>(db, backend, cache, engine, options,
+                                          stats);
   } else if (table_type == "base_of") {
-    return std::make_unique<RelationsTable>(db, SymbolIndex::NewStub(channel),
-                                            BaseOf);
+    return std::make_unique<RelationsTable>(db, backend, cache, engine, BaseOf,
+                                            options, stats);
   } else if (table_type == "overridden_by") {
-    return std::make_unique<RelationsTable>(db, SymbolIndex::NewStub(channel),
-                                            OverriddenBy);
+    return std::make_unique<RelationsTable>(db, backend, cache, engine,
+                                            OverriddenBy, options, stats);
   } else if (table_type == "refs") {
-    return std::make_unique<RefsTable>(db, SymbolIndex::NewStub(channel));
+    return std::make_unique<RefsTable>(db, backend, engine, options, stats);
   } else {
     throw std::runtime_error("Invalid table `" + table_type + "' requested");
   }
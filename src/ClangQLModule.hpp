@@ -1,11 +1,21 @@
 #ifndef CLANGQLMODULE_HPP
 #define CLANGQLMODULE_HPP
+#include "IndexBackend.hpp"
 #include "Module.hpp"
 
+#include <memory>
+#include <string>
+
 class ClangQLModule final : public Module {
 public:
   virtual std::unique_ptr<VirtualTable>
   Create(sqlite3 *db, int argc, const char *const *argv) override;
 };
 
+// Returns the backend for the connection string `addr`, which is shared by
+// every table using it. `snapshot:PATH` reads the snapshot at PATH, and other
+// strings name a server or a proxy. Throws std::runtime_error if the backend
+// can't be created.
+std::shared_ptr<IndexBackend> GetIndexBackend(const std::string &addr);
+
 #endif
\ No newline at end of file
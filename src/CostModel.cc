@@ -0,0 +1,108 @@
+#include "CostModel.hpp"
+SQLITE_EXTENSION_INIT3
+
+static PathCounters counters[num_access_paths];
+
+// Guesses used before anything has been observed, per key, in the order of
+// `AccessPath`
+static const PathEstimate priors[num_access_paths] = {
+ {1, 1000},         // SymbolById, a single round trip
+ {4, 2000},         // SymbolByName, overloads and a few scopes
+ {100, 5000},       // SymbolByFuzzyName
+ {500, 20000},      // SymbolByScope
+ {10000, 200000},   // SymbolByPath
+ {100000, 2000000}, // SymbolScan
+ {50, 3000},        // RefsById
+ {5, 1000},         // RelationsBySubject
+ {1, 0},            // Unusable
+};
+
+// How many observed keys weigh as much as the prior guess
+constexpr double prior_weight = 8;
+
+// Cost of reading a table without the constraint it needs. It is only
+// chosen if SQLite has no other way of running the query.
+constexpr double unusable_cost = 1e15;
+
+const char *AccessPathName(AccessPath path) {
+  switch (path) {
+  case AccessPath::SymbolById:
+    return "SymbolById";
+  case AccessPath::SymbolByName:
+    return "SymbolByName";
+  case AccessPath::SymbolByFuzzyName:
+    return "SymbolByFuzzyName";
+  case AccessPath::SymbolByScope:
+    return "SymbolByScope";
+  case AccessPath::SymbolByPath:
+    return "SymbolByPath";
+  case AccessPath::SymbolScan:
+    return "SymbolScan";
+  case AccessPath::RefsById:
+    return "RefsById";
+  case AccessPath::RelationsBySubject:
+    return "RelationsBySubject";
+  case AccessPath::Unusable:
+    return "Unusable";
+  }
+  return "Unknown";
+}
+
+PathCounters &GetPathCounters(AccessPath path) { return counters[(int)path]; }
+
+PathEstimate EstimatePath(AccessPath path) {
+  auto &observed = GetPathCounters(path);
+  auto &prior = priors[(int)path];
+
+  double keys = (double)observed.keys.load(std::memory_order_relaxed);
+  double rows = (double)observed.rows.load(std::memory_order_relaxed);
+  double micros = (double)observed.micros.load(std::memory_order_relaxed);
+  return {(prior.rows * prior_weight + rows) / (prior_weight + keys),
+          (prior.micros * prior_weight + micros) / (prior_weight + keys)};
+}
+
+void SetEstimates(sqlite3_index_info *info, AccessPath path, bool unique) {
+  if (path == AccessPath::Unusable) {
+    info->estimatedCost = unusable_cost;
+    if (sqlite3_libversion_number() >= 3008002) {
+      info->estimatedRows = 1;
+    }
+    return;
+  }
+
+  auto estimate = EstimatePath(path);
+  // Time spent waiting on the server is what dominates, so the cost is in
+  // microseconds. Each row costs at least one, for SQLite to process it.
+  info->estimatedCost = estimate.micros + estimate.rows;
+
+  // Both fields were added to sqlite3_index_info after the rest
+  if (sqlite3_libversion_number() >= 3008002) {
+    info->estimatedRows = unique ? 1 : (sqlite3_int64)(estimate.rows + 0.5);
+  }
+  if (unique && sqlite3_libversion_number() >= 3009000) {
+    info->idxFlags |= SQLITE_INDEX_SCAN_UNIQUE;
+  }
+}
+
+void ScanRecorder::Start(AccessPath path, uint64_t keys) {
+  m_path = path;
+  m_active = keys > 0 && path != AccessPath::Unusable;
+  m_keys = keys;
+  m_rows = 0;
+  m_start = std::chrono::steady_clock::now();
+}
+
+void ScanRecorder::Finish() {
+  if (!m_active) {
+    return;
+  }
+  m_active = false;
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+   std::chrono::steady_clock::now() - m_start);
+  auto &observed = GetPathCounters(m_path);
+  observed.keys.fetch_add(m_keys, std::memory_order_relaxed);
+  observed.rows.fetch_add(m_rows, std::memory_order_relaxed);
+  observed.micros.fetch_add((uint64_t)elapsed.count(),
+                            std::memory_order_relaxed);
+}
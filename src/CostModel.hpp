@@ -0,0 +1,80 @@
+#ifndef COSTMODEL_HPP
+#define COSTMODEL_HPP
+#include "sqlite3ext.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// The ways in which a table can be read, each with its own costs
+enum class AccessPath {
+  // `Lookup` of symbols by id
+  SymbolById,
+  // `FuzzyFind` of symbols with an exact name
+  SymbolByName,
+  // `FuzzyFind` of symbols with a name pattern
+  SymbolByFuzzyName,
+  // `FuzzyFind` of symbols in a scope
+  SymbolByScope,
+  // `FuzzyFind` of symbols near a path
+  SymbolByPath,
+  // `FuzzyFind` of every symbol
+  SymbolScan,
+  // `Refs` of a symbol
+  RefsById,
+  // `Relations` of a subject
+  RelationsBySubject,
+  // Reading a table without the constraint it needs, which yields no rows
+  Unusable
+};
+
+constexpr int num_access_paths = 9;
+
+const char *AccessPathName(AccessPath path);
+
+// What has been observed of an access path, shared by all connections. A
+// scan that processes several keys at once, e.g. the values of an IN
+// operator, counts once per key.
+struct PathCounters {
+  std::atomic<uint64_t> keys{0};
+  std::atomic<uint64_t> rows{0};
+  std::atomic<uint64_t> micros{0};
+};
+
+PathCounters &GetPathCounters(AccessPath path);
+
+struct PathEstimate {
+  // Rows produced for each key
+  double rows;
+  // Microseconds spent for each key
+  double micros;
+};
+
+// Estimates the rows and time of a scan from what has been observed so far,
+// starting from a fixed guess while there are few observations
+PathEstimate EstimatePath(AccessPath path);
+
+// Fills in the estimates of `info` for a plan reading `path`. Id lookups
+// that are not IN operators are marked as producing a single row.
+void SetEstimates(sqlite3_index_info *info, AccessPath path, bool unique);
+
+// Times a scan of an access path and counts its rows, to be recorded once the
+// scan is over. Scans that are not read to the end, or are cut short by a
+// LIMIT, don't say anything about the path and are not recorded.
+class ScanRecorder {
+  AccessPath m_path = AccessPath::Unusable;
+  bool m_active = false;
+  uint64_t m_keys = 0;
+  uint64_t m_rows = 0;
+  std::chrono::steady_clock::time_point m_start;
+
+public:
+  // Starts timing a scan of `keys` keys, forgetting any unfinished one
+  void Start(AccessPath path, uint64_t keys);
+  // Forgets the current scan
+  void Abandon() { m_active = false; }
+  void Row() { m_rows++; }
+  // Records the current scan, if any
+  void Finish();
+};
+
+#endif
@@ -1,5 +1,9 @@
 #ifndef IRESULTSTREAM_HPP
 #define IRESULTSTREAM_HPP
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
 
 template <typename T> class IResultStream {
 public:
@@ -7,6 +11,108 @@ public:
 
   virtual const T &Current() = 0;
   virtual bool Next() = 0;
+
+  // Tells the server that no more results are needed
+  virtual void Cancel() {}
+
+  // Whether the server reported having more results than it sent, once
+  // `Next` returned false
+  virtual bool HasMore() { return false; }
+
+  // Whether the server ended the results normally, with its final result,
+  // once `Next` returned false. Calls that failed or were cancelled before
+  // that have incomplete results.
+  virtual bool Ok() { return true; }
+
+  // Stores the current result in `dest`. The current result is left in an
+  // unspecified state.
+  virtual void MoveCurrent(T &dest) { dest = Current(); }
+
+  // Returns the current result in a form that outlives the next call to
+  // `Next`. `Current` must not be used again until then.
+  virtual std::shared_ptr<const T> ShareCurrent() {
+    auto res = std::make_shared<T>();
+    MoveCurrent(*res);
+    return res;
+  }
+};
+
+// Yields the results of a sequence of streams, one after the other
+template <typename T> class ConcatStream final : public IResultStream<T> {
+  std::vector<std::unique_ptr<IResultStream<T>>> m_streams;
+  size_t m_current = 0;
+
+public:
+  ConcatStream(std::vector<std::unique_ptr<IResultStream<T>>> streams)
+    : m_streams(std::move(streams)) {}
+
+  const T &Current() override { return m_streams[m_current]->Current(); }
+
+  bool Next() override {
+    while (m_current < m_streams.size()) {
+      if (m_streams[m_current]->Next()) {
+        return true;
+      }
+      m_current++;
+    }
+    return false;
+  }
+
+  void Cancel() override {
+    for (auto &stream : m_streams) {
+      stream->Cancel();
+    }
+  }
+
+  bool Ok() override {
+    for (auto &stream : m_streams) {
+      if (!stream->Ok()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void MoveCurrent(T &dest) override {
+    m_streams[m_current]->MoveCurrent(dest);
+  }
+
+  std::shared_ptr<const T> ShareCurrent() override {
+    return m_streams[m_current]->ShareCurrent();
+  }
+};
+
+// Keeps a stream of type `S` once its results were read, so that the next
+// call of a cursor can reuse it instead of allocating a new one. Nested loops
+// call xFilter once per outer row, often only to serve a few cached results.
+template <typename S, typename T> class StreamPool {
+  std::unique_ptr<S> m_spare;
+  S *m_inUse = nullptr;
+
+public:
+  // Returns the spare stream, or a new one if there is none. The spare
+  // stream has to be reset by the caller.
+  std::unique_ptr<S> Take() {
+    auto stream = m_spare ? std::move(m_spare) : std::make_unique<S>();
+    m_inUse = stream.get();
+    return stream;
+  }
+
+  // Gives back a stream from `Take` that ended up not being used
+  void Return(std::unique_ptr<S> stream) {
+    m_spare = std::move(stream);
+    m_inUse = nullptr;
+  }
+
+  // Empties `stream`, keeping it as the spare stream if it was handed out by
+  // `Take` and destroying it otherwise
+  void Recycle(std::unique_ptr<IResultStream<T>> &stream) {
+    if (stream && stream.get() == m_inUse) {
+      m_spare.reset(static_cast<S *>(stream.release()));
+    }
+    stream = nullptr;
+    m_inUse = nullptr;
+  }
 };
 
 #endif
\ No newline at end of file
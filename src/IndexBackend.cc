@@ -0,0 +1,73 @@
+#include "IndexBackend.hpp"
+#include "RpcStream.hpp"
+
+using namespace clang::clangd::remote;
+using clang::clangd::remote::v1::SymbolIndex;
+
+class RemoteLookupStream final : public RpcStream<LookupReply, Symbol> {
+public:
+  RemoteLookupStream(SymbolIndex::Stub &stub, const LookupRequest &req,
+                     RpcCounters &counters)
+    : RpcStream(counters) {
+    m_replyReader = stub.Lookup(&m_ctx, req);
+  }
+};
+
+class RemoteFuzzyFindStream final : public RpcStream<FuzzyFindReply, Symbol> {
+public:
+  RemoteFuzzyFindStream(SymbolIndex::Stub &stub, const FuzzyFindRequest &req,
+                        RpcCounters &counters)
+    : RpcStream(counters) {
+    m_replyReader = stub.FuzzyFind(&m_ctx, req);
+  }
+};
+
+class RemoteRefStream final : public RpcStream<RefsReply, Ref> {
+public:
+  RemoteRefStream(SymbolIndex::Stub &stub, const RefsRequest &req,
+                  RpcCounters &counters)
+    : RpcStream(counters) {
+    m_replyReader = stub.Refs(&m_ctx, req);
+  }
+};
+
+class RemoteRelationStream final : public RpcStream<RelationsReply, Relation> {
+public:
+  RemoteRelationStream(SymbolIndex::Stub &stub, const RelationsRequest &req,
+                       RpcCounters &counters)
+    : RpcStream(counters) {
+    m_replyReader = stub.Relations(&m_ctx, req);
+  }
+};
+
+RemoteIndexBackend::RemoteIndexBackend(std::shared_ptr<grpc::Channel> channel)
+  : m_channel(std::move(channel)), m_stub(SymbolIndex::NewStub(m_channel)),
+    m_wireStub(m_channel) {}
+
+std::unique_ptr<IResultStream<Symbol>>
+RemoteIndexBackend::Lookup(const LookupRequest &req, RpcCounters &counters) {
+  return std::make_unique<RemoteLookupStream>(*m_stub, req, counters);
+}
+
+std::unique_ptr<IResultStream<Symbol>>
+RemoteIndexBackend::FuzzyFind(const FuzzyFindRequest &req,
+                              RpcCounters &counters) {
+  return std::make_unique<RemoteFuzzyFindStream>(*m_stub, req, counters);
+}
+
+std::unique_ptr<IResultStream<Ref>>
+RemoteIndexBackend::Refs(const RefsRequest &req, RpcCounters &counters) {
+  return std::make_unique<RemoteRefStream>(*m_stub, req, counters);
+}
+
+std::unique_ptr<IResultStream<Relation>>
+RemoteIndexBackend::Relations(const RelationsRequest &req,
+                              RpcCounters &counters) {
+  return std::make_unique<RemoteRelationStream>(*m_stub, req, counters);
+}
+
+std::unique_ptr<IResultStream<Symbol>>
+RemoteIndexBackend::FuzzyFindFields(const FuzzyFindRequest &req,
+                                    uint32_t fields, RpcCounters &counters) {
+  return std::make_unique<WireSymbolStream>(m_wireStub, req, fields, counters);
+}
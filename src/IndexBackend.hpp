@@ -0,0 +1,81 @@
+#ifndef INDEXBACKEND_HPP
+#define INDEXBACKEND_HPP
+#include "IResultStream.hpp"
+#include "Service.grpc.pb.h"
+#include "Statistics.hpp"
+#include "WireSymbolStream.hpp"
+#include <grpcpp/grpcpp.h>
+
+#include <cstdint>
+#include <memory>
+
+// Where the tables get symbols, references and relations from. Requests and
+// results are those of the SymbolIndex service, whichever backend answers
+// them, and each call is accounted for in the counters it is given. There is
+// one backend for each connection string, shared by the tables using it.
+//
+// Caching, paging, prefetching and lookahead are done by the tables on top of
+// the streams returned here, the same way for every backend.
+class IndexBackend {
+public:
+  virtual ~IndexBackend() = default;
+
+  virtual std::unique_ptr<IResultStream<clang::clangd::remote::Symbol>>
+  Lookup(const clang::clangd::remote::LookupRequest &req,
+         RpcCounters &counters) = 0;
+  virtual std::unique_ptr<IResultStream<clang::clangd::remote::Symbol>>
+  FuzzyFind(const clang::clangd::remote::FuzzyFindRequest &req,
+            RpcCounters &counters) = 0;
+  virtual std::unique_ptr<IResultStream<clang::clangd::remote::Ref>>
+  Refs(const clang::clangd::remote::RefsRequest &req,
+       RpcCounters &counters) = 0;
+  virtual std::unique_ptr<IResultStream<clang::clangd::remote::Relation>>
+  Relations(const clang::clangd::remote::RelationsRequest &req,
+            RpcCounters &counters) = 0;
+
+  // Like `FuzzyFind`, except that symbols may only have the fields in
+  // `fields`, in the format of `DecodeSymbolReply`. Such symbols must not be
+  // cached. Returns null if the backend can't do that any faster than
+  // `FuzzyFind`.
+  virtual std::unique_ptr<IResultStream<clang::clangd::remote::Symbol>>
+  FuzzyFindFields(const clang::clangd::remote::FuzzyFindRequest &req,
+                  uint32_t fields, RpcCounters &counters) {
+    return nullptr;
+  }
+
+  // Channel to the server, for the calls made in the background by
+  // AsyncEngine, or null if the backend doesn't have a server
+  virtual std::shared_ptr<grpc::Channel> Channel() { return nullptr; }
+};
+
+// Backend calling a SymbolIndex server over gRPC
+class RemoteIndexBackend final : public IndexBackend {
+  std::shared_ptr<grpc::Channel> m_channel;
+  std::unique_ptr<clang::clangd::remote::v1::SymbolIndex::Stub> m_stub;
+  WireStub m_wireStub;
+
+public:
+  explicit RemoteIndexBackend(std::shared_ptr<grpc::Channel> channel);
+
+  std::unique_ptr<IResultStream<clang::clangd::remote::Symbol>>
+  Lookup(const clang::clangd::remote::LookupRequest &req,
+         RpcCounters &counters) override;
+  std::unique_ptr<IResultStream<clang::clangd::remote::Symbol>>
+  FuzzyFind(const clang::clangd::remote::FuzzyFindRequest &req,
+            RpcCounters &counters) override;
+  std::unique_ptr<IResultStream<clang::clangd::remote::Ref>>
+  Refs(const clang::clangd::remote::RefsRequest &req,
+       RpcCounters &counters) override;
+  std::unique_ptr<IResultStream<clang::clangd::remote::Relation>>
+  Relations(const clang::clangd::remote::RelationsRequest &req,
+            RpcCounters &counters) override;
+
+  // Decodes replies straight from the wire, skipping the other fields
+  std::unique_ptr<IResultStream<clang::clangd::remote::Symbol>>
+  FuzzyFindFields(const clang::clangd::remote::FuzzyFindRequest &req,
+                  uint32_t fields, RpcCounters &counters) override;
+
+  std::shared_ptr<grpc::Channel> Channel() override { return m_channel; }
+};
+
+#endif
@@ -2,16 +2,20 @@
 SQLITE_EXTENSION_INIT3
 
 #include "Module.hpp"
+#include "Trace.hpp"
 #include "VirtualTable.hpp"
 #include "VirtualTableCursor.hpp"
 #include <algorithm>
 #include <cstring>
 #include <new>
 #include <stdexcept>
+#include <string>
 
 struct module_vtab {
   sqlite3_vtab base;
   std::unique_ptr<VirtualTable> tab;
+  // Name of the table, to label traces
+  std::string name;
 };
 
 struct module_vtab_cur {
@@ -19,6 +23,20 @@ struct module_vtab_cur {
   std::unique_ptr<VirtualTableCursor> cur;
 };
 
+// Calls `fn`, turning any exception into an error code, and into the error
+// message of `vtab`, as exceptions must not unwind through SQLite
+template <typename Fn> static int guard(sqlite3_vtab *vtab, Fn fn) {
+  try {
+    return fn();
+  } catch (const std::bad_alloc &) {
+    return SQLITE_NOMEM;
+  } catch (const std::exception &e) {
+    sqlite3_free(vtab->zErrMsg);
+    vtab->zErrMsg = sqlite3_mprintf("%s", e.what());
+    return SQLITE_ERROR;
+  }
+}
+
 static int module_destroy(sqlite3_vtab *pVtab) {
   delete (module_vtab *)pVtab;
   return SQLITE_OK;
@@ -38,12 +56,14 @@ static int module_create(sqlite3 *db, void *pAux, int argc,
 
   try {
     vtab->tab = mod->Create(db, argc, argv);
+    vtab->name = argv[2];
     *ppVTab = &(vtab->base);
     return SQLITE_OK;
   } catch (std::bad_alloc e) {
     delete vtab;
     return SQLITE_NOMEM;
-  } catch (std::runtime_error e) {
+  } catch (const std::exception &e) {
+    delete vtab;
     auto err = e.what();
     auto errlen = std::strlen(err);
     *pzErr = static_cast<char *>(sqlite3_malloc64(errlen + 1));
@@ -67,16 +87,16 @@ static int module_open(sqlite3_vtab *pVTab, sqlite3_vtab_cursor **pp_cursor) {
     return SQLITE_NOMEM;
   }
 
-  try {
+  int rc = guard(pVTab, [&] {
     cur->cur = table->tab->Open();
-    *pp_cursor = &(cur->base);
     return SQLITE_OK;
-  } catch (std::bad_alloc e) {
+  });
+  if (rc != SQLITE_OK) {
     delete cur;
-    return SQLITE_NOMEM;
-  } catch (std::exception e) {
-    return SQLITE_ERROR;
+    return rc;
   }
+  *pp_cursor = &(cur->base);
+  return SQLITE_OK;
 }
 
 static int module_close(sqlite3_vtab_cursor *pVCur) {
@@ -89,36 +109,60 @@ static int module_eof(sqlite3_vtab_cursor *base) {
   return cur->cur->Eof();
 }
 
+// Adds the name of the table to the args of `span`
+static void trace_table(TraceSpan &span, sqlite3_vtab *base) {
+  if (span.Active()) {
+    span.AddArg(TraceArg("table", ((module_vtab *)base)->name));
+  }
+}
+
 static int module_next(sqlite3_vtab_cursor *base) {
   auto cur = (module_vtab_cur *)base;
-  return cur->cur->Next();
+  TraceSpan span("sqlite", "xNext");
+  trace_table(span, base->pVtab);
+  return guard(base->pVtab, [&] { return cur->cur->Next(); });
 }
 
 static int module_column(sqlite3_vtab_cursor *base, sqlite3_context *ctx,
                          int idxCol) {
   auto cur = (module_vtab_cur *)base;
-  return cur->cur->Column(ctx, idxCol);
+  TraceSpan span("sqlite", "xColumn");
+  trace_table(span, base->pVtab);
+  if (span.Active()) {
+    span.AddArg(TraceArg("column", (int64_t)idxCol));
+  }
+  return guard(base->pVtab, [&] { return cur->cur->Column(ctx, idxCol); });
 }
 
 static int module_rowid(sqlite3_vtab_cursor *base, sqlite3_int64 *rowid) {
   auto cur = (module_vtab_cur *)base;
-  try {
+  return guard(base->pVtab, [&] {
     *rowid = cur->cur->RowId();
     return SQLITE_OK;
-  } catch (std::exception e) {
-    return SQLITE_ERROR;
-  }
+  });
 }
 
 static int module_filter(sqlite3_vtab_cursor *base, int idxNum,
                          const char *idxStr, int argc, sqlite3_value **argv) {
   auto cur = (module_vtab_cur *)base;
-  return cur->cur->Filter(idxNum, idxStr, argc, argv);
+  TraceSpan span("sqlite", "xFilter");
+  trace_table(span, base->pVtab);
+  if (span.Active() && idxStr) {
+    span.AddArg(TraceArg("plan", idxStr));
+  }
+  return guard(base->pVtab,
+               [&] { return cur->cur->Filter(idxNum, idxStr, argc, argv); });
 }
 
 static int module_best_index(sqlite3_vtab *base, sqlite3_index_info *pIdxInfo) {
   auto tab = (module_vtab *)base;
-  return tab->tab->BestIndex(pIdxInfo);
+  TraceSpan span("sqlite", "xBestIndex");
+  trace_table(span, base);
+  int rc = guard(base, [&] { return tab->tab->BestIndex(pIdxInfo); });
+  if (span.Active() && pIdxInfo->idxStr) {
+    span.AddArg(TraceArg("plan", pIdxInfo->idxStr));
+  }
+  return rc;
 }
 
 static int module_find_function(sqlite3_vtab *base, int nArg, const char *zName,
@@ -0,0 +1,145 @@
+#ifndef PAGEDSTREAM_HPP
+#define PAGEDSTREAM_HPP
+#include "IResultStream.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+// Yields every result of a request, even when the server stops short of
+// sending all of them. The protocol has no way to ask for the results that
+// follow a given one, so while the server reports having more, the request is
+// sent again with twice the limit, and results that were already yielded are
+// recognized by their key and skipped.
+//
+// The next page is requested once half of the current one has been read, so
+// that it is usually on its way by the time it is needed.
+//
+// `Cancel` may be called from another thread than the one reading, as done by
+// PrefetchStream, so the pages it cancels are only replaced under `m_mutex`.
+template <typename Request, typename T>
+class PagedStream final : public IResultStream<T> {
+public:
+  using Fetch =
+   std::function<std::unique_ptr<IResultStream<T>>(const Request &)>;
+  using KeyFn = std::string (*)(const T &);
+
+private:
+  Request m_req;
+  Fetch m_fetch;
+  KeyFn m_key;
+  // Limit past which no more pages are requested
+  uint32_t m_maxLimit;
+
+  std::unique_ptr<IResultStream<T>> m_page;
+  std::unique_ptr<IResultStream<T>> m_nextPage;
+  // Limit of the request of `m_page`, and number of results read from it
+  uint32_t m_limit;
+  uint32_t m_read = 0;
+
+  std::unordered_set<std::string> m_seen;
+  std::atomic<bool> m_cancelled{false};
+  // Held while replacing `m_page` or `m_nextPage`, and while cancelling them
+  std::mutex m_mutex;
+
+  void StartNextPage() {
+    m_req.set_limit(m_limit > m_maxLimit / 2 ? m_maxLimit : m_limit * 2);
+    auto page = m_fetch(m_req);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Cancelled since it was checked, in which case the page is still kept so
+    // that its results are drained and accounted for
+    if (m_cancelled) {
+      page->Cancel();
+    }
+    m_nextPage = std::move(page);
+  }
+
+  // Takes `m_nextPage` out under the lock, so that it is destroyed, which may
+  // take a while, without holding it
+  std::unique_ptr<IResultStream<T>> TakeNextPage() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::move(m_nextPage);
+  }
+
+public:
+  // `first` is the stream of `req` if it was already started elsewhere
+  PagedStream(const Request &req, uint32_t maxLimit, Fetch fetch, KeyFn key,
+              std::unique_ptr<IResultStream<T>> first = nullptr)
+    : m_req(req), m_fetch(std::move(fetch)), m_key(key), m_maxLimit(maxLimit),
+      m_page(first ? std::move(first) : m_fetch(req)), m_limit(req.limit()) {}
+
+  const T &Current() override { return m_page->Current(); }
+
+  bool Next() override {
+    while (true) {
+      if (m_page->Next()) {
+        m_read++;
+        if (!m_nextPage && !m_cancelled && m_limit < m_maxLimit &&
+            m_read >= m_limit / 2) {
+          StartNextPage();
+        }
+        if (!m_seen.insert(m_key(m_page->Current())).second) {
+          continue;
+        }
+        return true;
+      }
+
+      if (m_cancelled || !m_page->HasMore() || m_limit >= m_maxLimit) {
+        // Cancels the next page if it was started for nothing
+        TakeNextPage();
+        return false;
+      }
+
+      if (!m_nextPage) {
+        StartNextPage();
+      }
+      // The finished page is destroyed once the lock is released
+      std::unique_ptr<IResultStream<T>> finished;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        finished = std::move(m_page);
+        m_page = std::move(m_nextPage);
+      }
+      m_limit = m_req.limit();
+      m_read = 0;
+    }
+  }
+
+  void Cancel() override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cancelled = true;
+    m_page->Cancel();
+    if (m_nextPage) {
+      m_nextPage->Cancel();
+    }
+  }
+
+  bool HasMore() override { return m_page->HasMore(); }
+
+  // Earlier pages ended normally, or no later page would have been read
+  bool Ok() override { return m_page->Ok(); }
+
+  void MoveCurrent(T &dest) override { m_page->MoveCurrent(dest); }
+
+  std::shared_ptr<const T> ShareCurrent() override {
+    return m_page->ShareCurrent();
+  }
+};
+
+// Sets the limit of `req` to `pageSize`, unless it is already lower, and
+// returns the limit of the whole result set
+template <typename Request>
+uint32_t SetFirstPage(Request &req, size_t pageSize) {
+  uint32_t maxLimit = req.has_limit() ? req.limit() : UINT32_MAX;
+  if (pageSize < maxLimit) {
+    req.set_limit(pageSize);
+  }
+  return maxLimit;
+}
+
+#endif
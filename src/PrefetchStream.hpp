@@ -0,0 +1,146 @@
+#ifndef PREFETCHSTREAM_HPP
+#define PREFETCHSTREAM_HPP
+#include "IResultStream.hpp"
+#include "Trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Reads results of another stream on a background thread, so that receiving
+// and parsing replies overlaps with SQLite consuming rows.
+//
+// Results are handed over through a bounded single-producer/single-consumer
+// ring: the worker only ever advances `m_tail` and the consumer `m_head`, so
+// no locks are taken as long as neither side has to wait for the other.
+template <typename T> class PrefetchStream final : public IResultStream<T> {
+  std::unique_ptr<IResultStream<T>> m_source;
+  std::vector<T> m_slots;
+
+  // Index of the slot holding the current result
+  std::atomic<size_t> m_head{0};
+  // Index of the next slot the worker will fill
+  std::atomic<size_t> m_tail{0};
+  // Whether the consumer is looking at the slot at `m_head`
+  bool m_hasCurrent = false;
+
+  std::atomic<bool> m_finished{false};
+  std::atomic<bool> m_stop{false};
+
+  // Only used to sleep when the ring is full or empty
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::atomic<int> m_waiters{0};
+
+  std::thread m_worker;
+
+  // `what` names the wait in traces
+  template <typename Pred> void Wait(const char *what, Pred ready) {
+    if (ready()) {
+      return;
+    }
+
+    TraceSpan span("wait", what);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_waiters++;
+    while (!ready()) {
+      // The timeout is only a safety net, the other side wakes us up as soon
+      // as it sees `m_waiters` set
+      m_cond.wait_for(lock, std::chrono::milliseconds(1));
+    }
+    m_waiters--;
+  }
+
+  void Wake() {
+    if (m_waiters > 0) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_cond.notify_all();
+    }
+  }
+
+  void Run() {
+    while (!m_stop) {
+      if (!m_source->Next()) {
+        break;
+      }
+
+      auto tail = m_tail.load(std::memory_order_relaxed);
+      Wait("prefetch ring full", [&] {
+        return m_stop || tail - m_head.load() < m_slots.size();
+      });
+      if (m_stop) {
+        break;
+      }
+
+      m_source->MoveCurrent(m_slots[tail % m_slots.size()]);
+      m_tail.store(tail + 1);
+      Wake();
+    }
+
+    m_finished = true;
+    Wake();
+  }
+
+public:
+  PrefetchStream(std::unique_ptr<IResultStream<T>> source, size_t depth)
+    : m_source(std::move(source)), m_slots(depth < 2 ? 2 : depth) {
+    m_worker = std::thread([this] { Run(); });
+  }
+
+  ~PrefetchStream() override {
+    m_stop = true;
+    m_source->Cancel();
+    Wake();
+    m_worker.join();
+  }
+
+  const T &Current() override {
+    return m_slots[m_head.load(std::memory_order_relaxed) % m_slots.size()];
+  }
+
+  bool Next() override {
+    auto head = m_head.load(std::memory_order_relaxed);
+    if (m_hasCurrent) {
+      // Give the previous slot back to the worker
+      m_head.store(++head);
+      m_hasCurrent = false;
+      Wake();
+    }
+
+    Wait("prefetch", [&] { return m_tail.load() != head || m_finished; });
+    if (m_tail.load() == head) {
+      return false;
+    }
+
+    m_hasCurrent = true;
+    return true;
+  }
+
+  void Cancel() override { m_source->Cancel(); }
+
+  bool HasMore() override { return m_finished && m_source->HasMore(); }
+
+  bool Ok() override { return m_finished && m_source->Ok(); }
+
+  void MoveCurrent(T &dest) override {
+    dest.Swap(&m_slots[m_head.load(std::memory_order_relaxed) %
+                       m_slots.size()]);
+  }
+};
+
+// Wraps `stream` in a PrefetchStream, unless `depth` is 0
+template <typename T>
+std::unique_ptr<IResultStream<T>>
+WithPrefetch(std::unique_ptr<IResultStream<T>> stream, size_t depth) {
+  if (depth == 0) {
+    return stream;
+  }
+  return std::make_unique<PrefetchStream<T>>(std::move(stream), depth);
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "QueryPlan.hpp"
+
+#include <cstring>
+
+static const char *op_name(PlanOp op) {
+  switch (op) {
+  case PlanOp::Eq:
+    return "eq";
+  case PlanOp::In:
+    return "in";
+  case PlanOp::Like:
+    return "like";
+  }
+  return "";
+}
+
+static bool parse_op(const std::string &name, PlanOp &op) {
+  for (auto candidate : {PlanOp::Eq, PlanOp::In, PlanOp::Like}) {
+    if (name == op_name(candidate)) {
+      op = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Reads characters up to one of `delims`, which is not consumed
+static std::string read_until(const char *&p, const char *delims) {
+  auto start = p;
+  while (*p && !std::strchr(delims, *p)) {
+    p++;
+  }
+  return std::string(start, p);
+}
+
+// Consumes `token` if it is next
+static bool skip(const char *&p, const char *token) {
+  auto len = std::strlen(token);
+  if (std::strncmp(p, token, len)) {
+    return false;
+  }
+  p += len;
+  return true;
+}
+
+const PlanArg *QueryPlan::Find(const char *key) const {
+  for (auto &arg : args) {
+    if (arg.key == key) {
+      return &arg;
+    }
+  }
+  return nullptr;
+}
+
+std::string QueryPlan::Format(const char *const *columnNames,
+                              int numColumns) const {
+  std::string res = call + "(";
+  for (size_t i = 0; i < args.size(); i++) {
+    if (i > 0) {
+      res += ",";
+    }
+    res += args[i].key + "=" + op_name(args[i].op);
+  }
+  res += ")";
+
+  if (limit) {
+    res += " limit=?";
+  }
+  if (offset) {
+    res += " offset=?";
+  }
+
+  if (columnNames) {
+    auto all = numColumns >= 64 ? ~0ULL : (1ULL << numColumns) - 1;
+    if ((columns & all) == all) {
+      res += " cols=*";
+    } else {
+      res += " cols={";
+      bool first = true;
+      for (int i = 0; i < numColumns && i < 64; i++) {
+        if (columns & (1ULL << i)) {
+          res += first ? "" : ",";
+          res += columnNames[i];
+          first = false;
+        }
+      }
+      res += "}";
+    }
+  }
+  return res;
+}
+
+bool QueryPlan::Parse(const char *text, const char *const *columnNames,
+                      int numColumns) {
+  if (!text) {
+    return false;
+  }
+  if (m_text == text) {
+    return true;
+  }
+
+  m_text.clear();
+  args.clear();
+  limit = false;
+  offset = false;
+  columns = ~0ULL;
+
+  auto p = text;
+  call = read_until(p, "(");
+  if (!skip(p, "(")) {
+    return false;
+  }
+  while (!skip(p, ")")) {
+    auto key = read_until(p, "=)");
+    PlanOp op;
+    if (!skip(p, "=") || !parse_op(read_until(p, ",)"), op)) {
+      return false;
+    }
+    args.push_back({std::move(key), op});
+    skip(p, ",");
+  }
+
+  while (*p) {
+    if (skip(p, " limit=?")) {
+      limit = true;
+    } else if (skip(p, " offset=?")) {
+      offset = true;
+    } else if (skip(p, " cols=*")) {
+      columns = ~0ULL;
+    } else if (skip(p, " cols={")) {
+      columns = 0;
+      while (!skip(p, "}")) {
+        auto name = read_until(p, ",}");
+        int i = 0;
+        while (i < numColumns && name != columnNames[i]) {
+          i++;
+        }
+        if (i == numColumns || !*p) {
+          return false;
+        }
+        columns |= 1ULL << i;
+        skip(p, ",");
+      }
+    } else {
+      return false;
+    }
+  }
+
+  m_text = text;
+  return true;
+}
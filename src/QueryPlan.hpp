@@ -0,0 +1,53 @@
+#ifndef QUERYPLAN_HPP
+#define QUERYPLAN_HPP
+#include "sqlite3ext.h"
+#include <string>
+#include <vector>
+
+enum class PlanOp { Eq, In, Like };
+
+// A constraint handled by the table, whose value is passed to xFilter
+struct PlanArg {
+  std::string key;
+  // `In` is an IN operator whose values are all passed at once
+  PlanOp op;
+};
+
+// How a table is going to be read, as decided by xBestIndex. It is passed to
+// xFilter in idxStr in a readable form, which also shows up in the output of
+// EXPLAIN QUERY PLAN, e.g.
+//
+//   FuzzyFind(name=eq,scope=like) limit=? cols={Id,Name}
+//
+// The arguments of xFilter are the values of `args`, in order, followed by
+// the LIMIT and OFFSET if the plan has them.
+class QueryPlan {
+  // The text this plan was last read from
+  std::string m_text;
+
+public:
+  // The request sent to the server
+  std::string call;
+  std::vector<PlanArg> args;
+  bool limit = false;
+  bool offset = false;
+  // The columns used by the query, in the format of colUsed
+  sqlite3_uint64 columns = ~0ULL;
+
+  void Add(std::string key, PlanOp op) { args.push_back({std::move(key), op}); }
+
+  // Returns the argument for `key`, or nullptr if there is none
+  const PlanArg *Find(const char *key) const;
+
+  // Columns are only listed if their names are given
+  std::string Format(const char *const *columnNames = nullptr,
+                     int numColumns = 0) const;
+
+  // Reads back a plan written by `Format`, returning false if `text` is not
+  // one. Reading the same text as last time does nothing, so that probes of
+  // a nested loop don't parse it over and over.
+  bool Parse(const char *text, const char *const *columnNames = nullptr,
+             int numColumns = 0);
+};
+
+#endif
@@ -0,0 +1,413 @@
+#include "RecordReplay.hpp"
+#include "Trace.hpp"
+#include <grpcpp/impl/rpc_service_method.h>
+#include <grpcpp/support/method_handler.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Methods of the SymbolIndex service, in the order of their numbers in
+// recordings
+static const char *const method_names[] = {
+ "/clang.clangd.remote.v1.SymbolIndex/Lookup",
+ "/clang.clangd.remote.v1.SymbolIndex/FuzzyFind",
+ "/clang.clangd.remote.v1.SymbolIndex/Refs",
+ "/clang.clangd.remote.v1.SymbolIndex/Relations"};
+
+constexpr int num_methods = sizeof(method_names) / sizeof(*method_names);
+
+// Recordings start with this, followed by one record per call: the method
+// number, the request, the number of replies, then each reply preceded by the
+// nanoseconds between the start of the call and its arrival, and finally the
+// nanoseconds until the status, its code and its message. Numbers and sizes
+// are varints, and each request, reply and message is preceded by its size.
+constexpr char recording_magic[8] = {'C', 'Q', 'L', 'R', 'E', 'C', '0', '1'};
+
+struct RecordedReply {
+  uint64_t delay;
+  grpc::ByteBuffer message;
+};
+
+struct RecordedCall {
+  int method;
+  std::string request;
+  std::vector<RecordedReply> replies;
+  uint64_t statusDelay;
+  grpc::StatusCode code;
+  std::string message;
+};
+
+static uint64_t nanos_since(Clock::time_point start) {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+          Clock::now() - start)
+   .count();
+}
+
+static std::string to_string(const grpc::ByteBuffer &buffer) {
+  std::vector<grpc::Slice> slices;
+  std::string res;
+  if (buffer.Dump(&slices).ok()) {
+    for (auto &slice : slices) {
+      res.append((const char *)slice.begin(), slice.size());
+    }
+  }
+  return res;
+}
+
+static grpc::ByteBuffer to_buffer(const std::string &bytes) {
+  grpc::Slice slice(bytes);
+  return grpc::ByteBuffer(&slice, 1);
+}
+
+static void put_varint(std::string &dest, uint64_t value) {
+  while (value >= 0x80) {
+    dest += (char)(value | 0x80);
+    value >>= 7;
+  }
+  dest += (char)value;
+}
+
+static void put_bytes(std::string &dest, const std::string &bytes) {
+  put_varint(dest, bytes.size());
+  dest += bytes;
+}
+
+// Reads the varints and byte strings of a recording loaded in memory
+class RecordingReader {
+  const std::string &m_data;
+  const std::string &m_path;
+  size_t m_pos;
+
+public:
+  RecordingReader(const std::string &data, const std::string &path)
+    : m_data(data), m_path(path), m_pos(sizeof(recording_magic)) {}
+
+  bool AtEnd() const { return m_pos == m_data.size(); }
+
+  uint64_t Varint() {
+    uint64_t res = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (m_pos == m_data.size()) {
+        break;
+      }
+      auto byte = (unsigned char)m_data[m_pos++];
+      res |= (uint64_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return res;
+      }
+    }
+    throw std::runtime_error(m_path + " is truncated");
+  }
+
+  std::string Bytes() {
+    auto size = Varint();
+    if (size > m_data.size() - m_pos) {
+      throw std::runtime_error(m_path + " is truncated");
+    }
+    m_pos += size;
+    return m_data.substr(m_pos - size, size);
+  }
+};
+
+// Service answering every SymbolIndex method with the raw bytes of the
+// messages, which are neither parsed nor serialized again
+class RawIndexService : public grpc::Service {
+public:
+  RawIndexService() {
+    for (int method = 0; method < num_methods; method++) {
+      AddMethod(new grpc::internal::RpcServiceMethod(
+       method_names[method], grpc::internal::RpcMethod::SERVER_STREAMING,
+       new grpc::internal::ServerStreamingHandler<
+        RawIndexService, grpc::ByteBuffer, grpc::ByteBuffer>(
+        [method](RawIndexService *service, grpc::ServerContext *ctx,
+                 const grpc::ByteBuffer *req,
+                 grpc::ServerWriter<grpc::ByteBuffer> *writer) {
+          return service->Call(method, *ctx, *req, *writer);
+        },
+        this)));
+    }
+  }
+
+  virtual grpc::Status Call(int method, grpc::ServerContext &ctx,
+                            const grpc::ByteBuffer &req,
+                            grpc::ServerWriter<grpc::ByteBuffer> &writer) = 0;
+};
+
+// Forwards calls to the upstream server and records them
+class RecordingService final : public RawIndexService {
+  std::shared_ptr<grpc::Channel> m_upstream;
+  std::vector<grpc::internal::RpcMethod> m_methods;
+  std::mutex m_mutex;
+  std::ofstream m_file;
+  std::string m_path;
+
+  void Append(const RecordedCall &call) {
+    std::string record;
+    put_varint(record, (uint64_t)call.method);
+    put_bytes(record, call.request);
+    put_varint(record, call.replies.size());
+    for (auto &reply : call.replies) {
+      put_varint(record, reply.delay);
+      put_bytes(record, to_string(reply.message));
+    }
+    put_varint(record, call.statusDelay);
+    put_varint(record, (uint64_t)call.code);
+    put_bytes(record, call.message);
+
+    // Flushed right away, so the recording is usable even if the process
+    // doesn't exit cleanly
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.write(record.data(), (std::streamsize)record.size());
+    m_file.flush();
+  }
+
+public:
+  RecordingService(const std::string &path, const std::string &upstream)
+    : m_upstream(
+       grpc::CreateChannel(upstream, grpc::InsecureChannelCredentials())),
+      m_file(path, std::ios::binary | std::ios::app), m_path(path) {
+    if (!m_file) {
+      throw std::runtime_error("Cannot write " + path);
+    }
+    if (m_file.tellp() == 0) {
+      m_file.write(recording_magic, sizeof(recording_magic));
+    }
+    for (auto name : method_names) {
+      m_methods.emplace_back(name, grpc::internal::RpcMethod::SERVER_STREAMING,
+                             m_upstream);
+    }
+  }
+
+  grpc::Status Call(int method, grpc::ServerContext &ctx,
+                    const grpc::ByteBuffer &req,
+                    grpc::ServerWriter<grpc::ByteBuffer> &writer) override {
+    TraceSpan span("proxy", "record");
+    auto start = Clock::now();
+    grpc::ClientContext upstreamCtx;
+    upstreamCtx.set_deadline(ctx.deadline());
+    std::unique_ptr<grpc::ClientReader<grpc::ByteBuffer>> reader(
+     grpc::internal::ClientReaderFactory<grpc::ByteBuffer>::Create(
+      m_upstream.get(), m_methods[method], &upstreamCtx, req));
+
+    RecordedCall call{method, to_string(req), {}, 0, grpc::StatusCode::OK, {}};
+    grpc::ByteBuffer reply;
+    while (reader->Read(&reply)) {
+      call.replies.push_back({nanos_since(start), reply});
+      if (!writer.Write(reply)) {
+        // The client is gone
+        upstreamCtx.TryCancel();
+        break;
+      }
+    }
+    auto status = reader->Finish();
+    call.statusDelay = nanos_since(start);
+    call.code = status.error_code();
+    call.message = status.error_message();
+    Append(call);
+    return status;
+  }
+};
+
+// Answers calls with the replies recorded for the same request
+class ReplayService final : public RawIndexService {
+  struct Recordings {
+    std::vector<RecordedCall> calls;
+    size_t next = 0;
+  };
+
+  // Recordings of each request, by method number and serialized request
+  std::unordered_map<std::string, Recordings> m_recordings;
+  std::mutex m_mutex;
+  double m_speed;
+
+  static std::string key(int method, const std::string &request) {
+    return std::string(1, (char)method) + request;
+  }
+
+  const RecordedCall *Next(int method, const std::string &request) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_recordings.find(key(method, request));
+    if (it == m_recordings.end()) {
+      return nullptr;
+    }
+    auto &recordings = it->second;
+    auto &call = recordings.calls[recordings.next];
+    recordings.next = (recordings.next + 1) % recordings.calls.size();
+    return &call;
+  }
+
+  void WaitUntil(Clock::time_point start, uint64_t delay) {
+    if (m_speed > 0) {
+      std::this_thread::sleep_until(
+       start + std::chrono::nanoseconds((int64_t)((double)delay / m_speed)));
+    }
+  }
+
+public:
+  ReplayService(const std::string &path, double speed) : m_speed(speed) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      throw std::runtime_error("Cannot read " + path);
+    }
+    std::string data((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+    if (data.compare(0, sizeof(recording_magic), recording_magic,
+                     sizeof(recording_magic)) != 0) {
+      throw std::runtime_error(path + " is not a recording");
+    }
+
+    RecordingReader reader(data, path);
+    while (!reader.AtEnd()) {
+      RecordedCall call;
+      call.method = (int)reader.Varint();
+      if (call.method >= num_methods) {
+        throw std::runtime_error(path + " is corrupted");
+      }
+      call.request = reader.Bytes();
+      for (auto count = reader.Varint(); count > 0; count--) {
+        auto delay = reader.Varint();
+        call.replies.push_back({delay, to_buffer(reader.Bytes())});
+      }
+      call.statusDelay = reader.Varint();
+      call.code = (grpc::StatusCode)reader.Varint();
+      call.message = reader.Bytes();
+      m_recordings[key(call.method, call.request)].calls.push_back(
+       std::move(call));
+    }
+  }
+
+  grpc::Status Call(int method, grpc::ServerContext &ctx,
+                    const grpc::ByteBuffer &req,
+                    grpc::ServerWriter<grpc::ByteBuffer> &writer) override {
+    TraceSpan span("proxy", "replay");
+    auto start = Clock::now();
+    auto call = Next(method, to_string(req));
+    if (!call) {
+      return grpc::Status(grpc::StatusCode::NOT_FOUND,
+                          "Request not found in the recording");
+    }
+
+    for (auto &reply : call->replies) {
+      WaitUntil(start, reply.delay);
+      if (!writer.Write(reply.message)) {
+        return grpc::Status::CANCELLED;
+      }
+    }
+    WaitUntil(start, call->statusDelay);
+    return grpc::Status(call->code, call->message);
+  }
+};
+
+// Server of a proxy, reached through a channel that doesn't leave the process
+class Proxy {
+  std::unique_ptr<RawIndexService> m_service;
+  std::unique_ptr<grpc::Server> m_server;
+
+public:
+  explicit Proxy(std::unique_ptr<RawIndexService> service)
+    : m_service(std::move(service)) {
+    grpc::ServerBuilder builder;
+    builder.RegisterService(m_service.get());
+    m_server = builder.BuildAndStart();
+    if (!m_server) {
+      throw std::runtime_error("Cannot start the proxy");
+    }
+  }
+
+  ~Proxy() { m_server->Shutdown(); }
+
+  std::shared_ptr<grpc::Channel> Channel() {
+    return m_server->InProcessChannel(grpc::ChannelArguments());
+  }
+};
+
+// Splits `query`, made of `key=value` pairs separated by `&`
+static std::unordered_map<std::string, std::string>
+parse_query(const std::string &addr, const std::string &query) {
+  std::unordered_map<std::string, std::string> res;
+  size_t start = 0;
+  while (start < query.size()) {
+    auto end = query.find('&', start);
+    if (end == std::string::npos) {
+      end = query.size();
+    }
+    auto pair = query.substr(start, end - start);
+    auto eq = pair.find('=');
+    if (eq == std::string::npos) {
+      throw std::runtime_error("Invalid parameter `" + pair + "' in `" + addr +
+                               "'");
+    }
+    res[pair.substr(0, eq)] = pair.substr(eq + 1);
+    start = end + 1;
+  }
+  return res;
+}
+
+static std::unique_ptr<RawIndexService>
+create_service(const std::string &addr) {
+  auto colon = addr.find(':');
+  auto mode = addr.substr(0, colon);
+  if (colon == std::string::npos || (mode != "record" && mode != "replay")) {
+    return nullptr;
+  }
+
+  auto rest = addr.substr(colon + 1);
+  auto question = rest.find('?');
+  auto path = rest.substr(0, question);
+  auto params = parse_query(
+   addr, question == std::string::npos ? "" : rest.substr(question + 1));
+  if (path.empty()) {
+    throw std::runtime_error("Missing file in `" + addr + "'");
+  }
+
+  if (mode == "record") {
+    auto upstream = params.find("upstream");
+    if (upstream == params.end() || params.size() != 1) {
+      throw std::runtime_error("`" + addr +
+                               "' needs an upstream=HOST:PORT parameter only");
+    }
+    return std::make_unique<RecordingService>(path, upstream->second);
+  }
+
+  double speed = 1;
+  for (auto &param : params) {
+    char *end;
+    speed = std::strtod(param.second.c_str(), &end);
+    if (param.first != "speed" || param.second.empty() || *end != '\0' ||
+        speed < 0) {
+      throw std::runtime_error("Invalid parameter `" + param.first + "=" +
+                               param.second + "' in `" + addr + "'");
+    }
+  }
+  return std::make_unique<ReplayService>(path, speed);
+}
+
+std::shared_ptr<grpc::Channel> GetProxyChannel(const std::string &addr) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::unique_ptr<Proxy>> proxies;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto it = proxies.find(addr);
+  if (it != proxies.end()) {
+    return it->second->Channel();
+  }
+
+  auto service = create_service(addr);
+  if (!service) {
+    return nullptr;
+  }
+  auto &proxy = proxies[addr];
+  proxy = std::make_unique<Proxy>(std::move(service));
+  return proxy->Channel();
+}
@@ -0,0 +1,28 @@
+#ifndef RECORDREPLAY_HPP
+#define RECORDREPLAY_HPP
+#include <grpcpp/grpcpp.h>
+
+#include <memory>
+#include <string>
+
+// Connection strings can name a proxy running inside the extension instead of
+// a server:
+//
+// - `record:PATH?upstream=HOST:PORT` forwards every call to the server at
+//   HOST:PORT, and appends the request, the replies and their timing to the
+//   file at PATH.
+// - `replay:PATH` answers the calls recorded in PATH without any server, with
+//   the recorded replies at their recorded times. `replay:PATH?speed=N`
+//   replays N times faster, and a speed of 0 sends the replies right away.
+//
+// Replies are passed through as they came over the wire, so the stubs, the
+// wire stub and the async engine all go through the proxy unchanged. The same
+// request recorded several times is replayed with each of its replies in
+// turn. Requests that were never recorded fail with NOT_FOUND.
+
+// Returns a channel to the proxy named by `addr`, started the first time it is
+// asked for, or null if `addr` is the address of a server. Throws
+// std::runtime_error if `addr` is invalid or its file can't be used.
+std::shared_ptr<grpc::Channel> GetProxyChannel(const std::string &addr);
+
+#endif
@@ -1,14 +1,19 @@
 #include "RefsTable.hpp"
+#include "CostModel.hpp"
 #include "IResultStream.hpp"
+#include "PagedStream.hpp"
+#include "PrefetchStream.hpp"
 #include "sqlite3ext.h"
 SQLITE_EXTENSION_INIT3
 #include "VirtualTableCursor.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <deque>
 #include <string>
 #include <vector>
 
 using namespace clang::clangd::remote;
-using clang::clangd::remote::v1::SymbolIndex;
 
 enum RefKind {
   Kind_Unknown = 0,
@@ -19,55 +24,219 @@ enum RefKind {
   Kind_All = Kind_Declaration | Kind_Definition | Kind_Reference | Kind_Spelled
 };
 
-class RefStream final : public IResultStream<Ref> {
-  grpc::ClientContext m_ctx;
-  std::unique_ptr<grpc::ClientReader<RefsReply>> m_replyReader;
-  RefsRequest m_req;
-  RefsReply m_reply;
-
-public:
-  RefStream(SymbolIndex::Stub &stub, RefsRequest &req)
-    : m_replyReader(stub.Refs(&m_ctx, req)), m_req(req) {}
-
-  const Ref &Current() override { return m_reply.stream_result(); }
-
-  bool Next() override {
-    return m_replyReader->Read(&m_reply) && m_reply.has_stream_result();
-  }
+static std::string ref_key(const Ref &ref) {
+  return std::to_string(ref.kind()) + ref.location().SerializeAsString();
+}
 
-  const std::string &Id() { return m_req.ids(0); }
+// The boolean columns telling whether a reference has a kind, and the keys of
+// their constraints in the plan
+struct KindColumn {
+  int column;
+  RefKind kind;
+  const char *key;
 };
 
-enum {
-  CONSTR_ID = 1,
-  CONSTR_DEF = 2,
-  CONSTR_DECL = 4,
-  CONSTR_REF = 8,
-  CONSTR_SPE = 16
+constexpr KindColumn kind_columns[] = {
+ {1, Kind_Declaration, "declaration"},
+ {2, Kind_Definition, "definition"},
+ {3, Kind_Reference, "reference"},
+ {4, Kind_Spelled, "spelled"},
 };
 
+// Maximum number of requests that are kept in flight when querying the
+// references of multiple symbols
+constexpr size_t refs_batch_window = 16;
+
 class RefsCursor final : public VirtualTableCursor {
-  SymbolIndex::Stub &m_stub;
+  IndexBackend &m_backend;
+  // Null unless the table reads ahead
+  AsyncEngine *m_engine;
+  const TableOptions &m_options;
+  TableStats &m_stats;
+
+  RpcCounters &Counters() { return m_stats.Rpc(RpcKind::Refs); }
   bool m_eof = false;
-  std::unique_ptr<RefStream> m_stream = nullptr;
+
+  // Replies carry no symbol id, so each symbol needs its own request for the
+  // `SymbolId` column to be known. Requests are issued ahead of time, and the
+  // stream at the front is the one being read.
+  std::deque<std::unique_ptr<IResultStream<Ref>>> m_streams;
+  std::vector<std::string> m_ids;
+  size_t m_nextId = 0;
+  // Only the stream being read gets a prefetch thread, the others are
+  // buffered by gRPC in the meantime
+  bool m_frontPrefetched = false;
+  // The server returns references having any of the kinds in `m_filter`,
+  // which is only exact in some cases. Kind constraints are enforced here by
+  // requiring every kind in `m_required` and none in `m_excluded`.
+  uint32_t m_filter = Kind_All;
+  bool m_exactFilter = true;
+  uint32_t m_required = 0;
+  uint32_t m_excluded = 0;
+  // Number of rows that SQLite can still consume, or -1 if unbounded
+  sqlite3_int64 m_remaining = -1;
+  ScanRecorder m_scan;
+  QueryPlan m_plan;
+
+  // Number of references needed from the server for each id
+  uint32_t MaxLimit() {
+    // Rows dropped here would make a limit on the server too short
+    if (m_remaining > 0 && m_exactFilter) {
+      return (uint32_t)std::min<sqlite3_int64>(m_remaining, UINT32_MAX);
+    }
+    return UINT32_MAX;
+  }
+
+  RefsRequest MakeRequest(const std::string &id) {
+    RefsRequest req;
+    req.add_ids(id);
+    req.set_filter(m_filter);
+    if (m_remaining > 0 && m_exactFilter) {
+      req.set_limit(MaxLimit());
+    }
+    if (m_options.page_size) {
+      SetFirstPage(req, m_options.page_size);
+    }
+    return req;
+  }
+
+  void FillWindow() {
+    while (m_streams.size() < refs_batch_window && m_nextId < m_ids.size()) {
+      auto req = MakeRequest(m_ids[m_nextId++]);
+      // The call may have been started when another table announced the id
+      std::unique_ptr<IResultStream<Ref>> stream;
+      if (m_engine) {
+        stream = m_engine->Take(req);
+      }
+      if (!stream) {
+        stream = m_backend.Refs(req, Counters());
+      }
+      if (m_options.page_size) {
+        stream = std::make_unique<PagedStream<RefsRequest, Ref>>(
+         req, MaxLimit(),
+         [this](const RefsRequest &page)
+          -> std::unique_ptr<IResultStream<Ref>> {
+           return m_backend.Refs(page, Counters());
+         },
+         ref_key, std::move(stream));
+      }
+      m_streams.push_back(std::move(stream));
+    }
+
+    if (!m_frontPrefetched && !m_streams.empty()) {
+      m_streams.front() =
+       WithPrefetch(std::move(m_streams.front()), m_options.prefetch);
+      m_frontPrefetched = true;
+    }
+  }
+
+  const std::string &CurrentId() {
+    return m_ids[m_nextId - m_streams.size()];
+  }
+
+  bool Matches(const Ref &ref) {
+    return (ref.kind() & m_required) == m_required &&
+           (ref.kind() & m_excluded) == 0;
+  }
+
+  // Turns the constraints on the kind columns into the kinds required and
+  // excluded, returning false if no reference can satisfy them
+  bool ReadKindConstraints(sqlite3_value **argv, int &argIndex) {
+    m_required = 0;
+    m_excluded = 0;
+    for (auto &arg : m_plan.args) {
+      auto column = std::find_if(
+       std::begin(kind_columns), std::end(kind_columns),
+       [&](const KindColumn &column) { return arg.key == column.key; });
+      if (column == std::end(kind_columns)) {
+        continue;
+      }
+
+      // The column is either 0 or 1, so check which of those are allowed
+      bool allowed[2] = {false, false};
+      ForEachValue(argv[argIndex++], arg.op == PlanOp::In,
+                   [&](sqlite3_value *value) {
+                     if (sqlite3_value_numeric_type(value) != SQLITE_INTEGER &&
+                         sqlite3_value_numeric_type(value) != SQLITE_FLOAT) {
+                       return;
+                     }
+                     auto number = sqlite3_value_double(value);
+                     if (number == 0 || number == 1) {
+                       allowed[(int)number] = true;
+                     }
+                   });
+
+      if (!allowed[0] && !allowed[1]) {
+        return false;
+      } else if (!allowed[0]) {
+        m_required |= column->kind;
+      } else if (!allowed[1]) {
+        m_excluded |= column->kind;
+      }
+    }
+    if (m_required & m_excluded) {
+      return false;
+    }
+
+    // Ask the server for the narrowest set of references it can filter
+    if (m_required) {
+      m_filter = m_required & -m_required;
+      m_exactFilter = m_required == m_filter && !m_excluded;
+    } else if (m_excluded) {
+      m_filter = Kind_All & ~m_excluded;
+      m_exactFilter = false;
+    } else {
+      m_filter = Kind_All;
+      m_exactFilter = true;
+    }
+    return m_filter != 0;
+  }
 
 public:
-  RefsCursor(SymbolIndex::Stub &stub) : m_stub(stub) {}
+  RefsCursor(IndexBackend &backend, AsyncEngine *engine,
+             const TableOptions &options, TableStats &stats)
+    : m_backend(backend), m_engine(engine), m_options(options),
+      m_stats(stats) {}
 
   int Eof() override { return m_eof; }
   int Next() override {
-    m_eof = !m_stream->Next();
+    if (m_remaining == 0) {
+      m_eof = true;
+      return SQLITE_OK;
+    }
+
+    while (!m_streams.empty()) {
+      if (m_streams.front()->Next()) {
+        if (!Matches(m_streams.front()->Current())) {
+          continue;
+        }
+        m_eof = false;
+        m_scan.Row();
+        if (m_remaining > 0 && --m_remaining == 0) {
+          // SQLite is not going to ask for more rows than this, so let the
+          // server know it can stop sending them
+          for (auto &stream : m_streams) {
+            stream->Cancel();
+          }
+        }
+        return SQLITE_OK;
+      }
+      m_streams.pop_front();
+      m_frontPrefetched = false;
+      FillWindow();
+    }
+    m_eof = true;
+    m_scan.Finish();
     return SQLITE_OK;
   }
   sqlite3_int64 RowId() override { return 0; }
   int Column(sqlite3_context *ctx, int idxCol) override {
-    auto &Current = m_stream->Current();
+    auto &Current = m_streams.front()->Current();
     switch (idxCol) {
 #define SET_RES2(field1, field2)                                               \
   do {                                                                         \
     if (Current.has_##field1() && Current.field1().has_##field2()) {           \
-      sqlite3_result_text(ctx, Current.field1().field2().c_str(), -1,          \
-                          SQLITE_TRANSIENT);                                   \
+      ResultText(ctx, Current.field1().field2());                              \
     } else {                                                                   \
       sqlite3_result_null(ctx);                                                \
     }                                                                          \
@@ -83,7 +252,7 @@ public:
   } while (0)
 
     case 0:
-      sqlite3_result_text(ctx, m_stream->Id().c_str(), -1, SQLITE_TRANSIENT);
+      ResultText(ctx, CurrentId());
       break;
     case 1:
       sqlite3_result_int(ctx, (Current.kind() & Kind_Declaration) ==
@@ -122,43 +291,48 @@ public:
   }
   int Filter(int idxNum, const char *idxStr, int argc,
              sqlite3_value **argv) override {
-    if (idxNum) {
-      RefsRequest req;
-      int argvIndex = 0;
-      int kind = Kind_All;
+    m_streams.clear();
+    m_nextId = 0;
+    m_frontPrefetched = false;
+    m_remaining = -1;
+    m_scan.Abandon();
+    if (!m_plan.Parse(idxStr)) {
+      return SQLITE_ERROR;
+    }
 
-      if (idxNum & CONSTR_ID) {
-        req.add_ids((const char *)sqlite3_value_text(argv[argvIndex++]));
-      }
+    if (!m_plan.args.empty()) {
+      int argvIndex = 0;
 
-      if (idxNum & CONSTR_DEF) {
-        if (!sqlite3_value_int(argv[argvIndex++])) {
-          kind &= !Kind_Definition;
-        }
+      // The ids are kept across calls to reuse their storage. They come
+      // first, followed by the kinds.
+      if (auto id = m_plan.Find("id")) {
+        TextValues(argv[argvIndex++], id->op == PlanOp::In, m_ids);
+      } else {
+        m_ids.clear();
       }
 
-      if (idxNum & CONSTR_DECL) {
-        if (!sqlite3_value_int(argv[argvIndex++])) {
-          kind &= !Kind_Declaration;
-        }
+      if (!ReadKindConstraints(argv, argvIndex)) {
+        m_ids.clear();
+        m_eof = true;
+        return SQLITE_OK;
       }
 
-      if (idxNum & CONSTR_REF) {
-        if (!sqlite3_value_int(argv[argvIndex++])) {
-          kind &= !Kind_Reference;
-        }
+      m_remaining = RowLimit(m_plan, argv, argvIndex);
+      if (m_remaining < 0) {
+        m_scan.Start(AccessPath::RefsById, m_ids.size());
       }
+      FillWindow();
 
-      if (idxNum & CONSTR_SPE) {
-        if (!sqlite3_value_int(argv[argvIndex++])) {
-          kind &= !Kind_Spelled;
+      // When probed with a key announced by the outer side of a join, the
+      // following probes are going to use the keys announced after it
+      if (m_engine && m_ids.size() == 1) {
+        for (auto &id : m_engine->Upcoming(m_ids[0], m_options.lookahead)) {
+          m_engine->Start(MakeRequest(id), Counters());
         }
       }
-
-      req.set_filter(kind);
-      m_stream = std::make_unique<RefStream>(m_stub, req);
       return Next();
     } else {
+      m_ids.clear();
       m_eof = true;
       return SQLITE_OK;
     }
@@ -175,8 +349,12 @@ constexpr const char *schema = R"cpp(
       Path, StartLine, StartCol, EndLine, EndCol))
   WITHOUT ROWID)cpp";
 
-RefsTable::RefsTable(sqlite3 *db, std::unique_ptr<SymbolIndex::Stub> stub)
-  : m_stub(std::move(stub)) {
+RefsTable::RefsTable(sqlite3 *db, std::shared_ptr<IndexBackend> backend,
+                     std::shared_ptr<AsyncEngine> engine,
+                     const TableOptions &options,
+                     std::shared_ptr<TableStats> stats)
+  : m_backend(std::move(backend)), m_engine(std::move(engine)),
+    m_options(options), m_stats(std::move(stats)) {
   int err = sqlite3_declare_vtab(db, schema);
   if (err != SQLITE_OK) {
     auto errmsg = sqlite3_errmsg(db);
@@ -185,6 +363,8 @@ RefsTable::RefsTable(sqlite3 *db, std::unique_ptr<SymbolIndex::Stub> stub)
 }
 
 int RefsTable::BestIndex(sqlite3_index_info *info) {
+  QueryPlan plan;
+  plan.call = "Refs";
   int argvIndex = 0;
 
   // Check for id
@@ -194,63 +374,41 @@ int RefsTable::BestIndex(sqlite3_index_info *info) {
       continue;
     if (constraint.iColumn == 0) {
       info->aConstraintUsage[i].argvIndex = ++argvIndex;
-      info->idxNum |= CONSTR_ID;
-      info->estimatedCost = 1;
-      break;
-    }
-  }
-
-  // Check for def
-  for (int i = 0; i < info->nConstraint; i++) {
-    auto &constraint = info->aConstraint[i];
-    if (!constraint.usable || constraint.op != SQLITE_INDEX_CONSTRAINT_EQ)
-      continue;
-    if (constraint.iColumn == 1) {
-      info->aConstraintUsage[i].argvIndex = ++argvIndex;
-      info->idxNum |= CONSTR_DEF;
-      break;
-    }
-  }
-
-  // Check for decl
-  for (int i = 0; i < info->nConstraint; i++) {
-    auto &constraint = info->aConstraint[i];
-    if (!constraint.usable || constraint.op != SQLITE_INDEX_CONSTRAINT_EQ)
-      continue;
-    if (constraint.iColumn == 2) {
-      info->aConstraintUsage[i].argvIndex = ++argvIndex;
-      info->idxNum |= CONSTR_DEF;
+      // Every row has exactly the requested id
+      info->aConstraintUsage[i].omit = 1;
+      bool isIn = CanProcessInAllAtOnce() && sqlite3_vtab_in(info, i, 1);
+      plan.Add("id", isIn ? PlanOp::In : PlanOp::Eq);
       break;
     }
   }
 
-  // Check for ref
-  for (int i = 0; i < info->nConstraint; i++) {
-    auto &constraint = info->aConstraint[i];
-    if (!constraint.usable || constraint.op != SQLITE_INDEX_CONSTRAINT_EQ)
-      continue;
-    if (constraint.iColumn == 3) {
-      info->aConstraintUsage[i].argvIndex = ++argvIndex;
-      info->idxNum |= CONSTR_REF;
-      break;
+  // Check for the kinds, which are all checked by the cursor
+  for (auto &column : kind_columns) {
+    for (int i = 0; i < info->nConstraint; i++) {
+      auto &constraint = info->aConstraint[i];
+      if (!constraint.usable || constraint.op != SQLITE_INDEX_CONSTRAINT_EQ)
+        continue;
+      if (constraint.iColumn == column.column) {
+        info->aConstraintUsage[i].argvIndex = ++argvIndex;
+        info->aConstraintUsage[i].omit = 1;
+        bool isIn = CanProcessInAllAtOnce() && sqlite3_vtab_in(info, i, 1);
+        plan.Add(column.key, isIn ? PlanOp::In : PlanOp::Eq);
+        break;
+      }
     }
   }
 
-  // Check for spelled
-  for (int i = 0; i < info->nConstraint; i++) {
-    auto &constraint = info->aConstraint[i];
-    if (!constraint.usable || constraint.op != SQLITE_INDEX_CONSTRAINT_EQ)
-      continue;
-    if (constraint.iColumn == 4) {
-      info->aConstraintUsage[i].argvIndex = ++argvIndex;
-      info->idxNum |= CONSTR_SPE;
-      break;
-    }
-  }
+  // Without an id there is nothing to ask the server
+  SetEstimates(info,
+               plan.Find("id") ? AccessPath::RefsById : AccessPath::Unusable,
+               false);
+  UseLimitOffset(info, argvIndex, plan);
+  SetPlan(info, plan);
 
   return SQLITE_OK;
 }
 
 std::unique_ptr<VirtualTableCursor> RefsTable::Open() {
-  return std::make_unique<RefsCursor>(*m_stub);
+  return std::make_unique<RefsCursor>(*m_backend, m_engine.get(), m_options,
+                                      *m_stats);
 }
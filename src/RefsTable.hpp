@@ -1,15 +1,22 @@
 #ifndef REFTABLE_HPP
 #define REFTABLE_HPP
-#include "Service.grpc.pb.h"
+#include "AsyncEngine.hpp"
+#include "IndexBackend.hpp"
+#include "Statistics.hpp"
+#include "TableOptions.hpp"
 #include "VirtualTable.hpp"
 #include "sqlite3ext.h"
 
 class RefsTable : public VirtualTable {
-  std::unique_ptr<clang::clangd::remote::v1::SymbolIndex::Stub> m_stub;
+  std::shared_ptr<IndexBackend> m_backend;
+  std::shared_ptr<AsyncEngine> m_engine;
+  TableOptions m_options;
+  std::shared_ptr<TableStats> m_stats;
 
 public:
-  RefsTable(sqlite3 *db,
-            std::unique_ptr<clang::clangd::remote::v1::SymbolIndex::Stub> stub);
+  RefsTable(sqlite3 *db, std::shared_ptr<IndexBackend> backend,
+            std::shared_ptr<AsyncEngine> engine, const TableOptions &options,
+            std::shared_ptr<TableStats> stats);
 
   virtual int BestIndex(sqlite3_index_info *info) override;
   virtual std::unique_ptr<VirtualTableCursor> Open() override;
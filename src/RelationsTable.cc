@@ -1,70 +1,209 @@
 #include "RelationsTable.hpp"
+#include "CostModel.hpp"
 #include "IResultStream.hpp"
+#include "PagedStream.hpp"
+#include "PrefetchStream.hpp"
+#include "SymbolId.hpp"
 #include "sqlite3ext.h"
 SQLITE_EXTENSION_INIT3
 #include "VirtualTableCursor.hpp"
 
-#include <chrono>
+#include <algorithm>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 using namespace clang::clangd::remote;
-using clang::clangd::remote::v1::SymbolIndex;
 
+// Stream of the relations of `source`, whose objects are stored in the cache
+// as they are read
 class RelationStream final : public IResultStream<Relation> {
-  grpc::ClientContext m_ctx;
-  std::unique_ptr<grpc::ClientReader<RelationsReply>> m_replyReader;
-  RelationsReply m_reply;
+  std::unique_ptr<IResultStream<Relation>> m_source;
+  SymbolCache &m_cache;
 
 public:
-  RelationStream(SymbolIndex::Stub &stub, RelationsRequest &req)
-    : m_replyReader(stub.Relations(&m_ctx, req)) {}
+  RelationStream(std::unique_ptr<IResultStream<Relation>> source,
+                 SymbolCache &cache)
+    : m_source(std::move(source)), m_cache(cache) {}
 
-  virtual const Relation &Current() override { return m_reply.stream_result(); }
+  const Relation &Current() override { return m_source->Current(); }
 
   virtual bool Next() override {
-    return m_replyReader->Read(&m_reply) && m_reply.has_stream_result();
+    if (m_source->Next()) {
+      // The objects of a relation are usually joined against a symbols table
+      // right after, so keep them around
+      if (Current().has_object()) {
+        m_cache.Insert(Current().object());
+      }
+      return true;
+    }
+    return false;
+  }
+
+  void Cancel() override { m_source->Cancel(); }
+  bool HasMore() override { return m_source->HasMore(); }
+  bool Ok() override { return m_source->Ok(); }
+  void MoveCurrent(Relation &dest) override { m_source->MoveCurrent(dest); }
+};
+
+static std::string relation_key(const Relation &rel) {
+  return rel.subject_id() + rel.object().id();
+}
+
+// Serves the relations of a subject that was already queried by the
+// statement, from the ids of their objects. Only the ids are set, which is all
+// that the columns show.
+class MemoStream final : public IResultStream<Relation> {
+  const std::vector<std::string> *m_objects = nullptr;
+  size_t m_next = 0;
+  Relation m_current;
+
+public:
+  void Reset(const std::string &subject,
+             const std::vector<std::string> &objects) {
+    m_objects = &objects;
+    m_next = 0;
+    m_current.set_subject_id(subject);
+  }
+
+  const Relation &Current() override { return m_current; }
+
+  bool Next() override {
+    if (m_next == m_objects->size()) {
+      return false;
+    }
+    m_current.mutable_object()->set_id((*m_objects)[m_next++]);
+    return true;
   }
 };
 
+// Maximum number of relations remembered by a cursor
+constexpr size_t relations_memo_capacity = 1 << 16;
+
 class RelationsCursor final : public VirtualTableCursor {
-  SymbolIndex::Stub &m_stub;
+  IndexBackend &m_backend;
+  SymbolCache &m_cache;
+  // Null unless the table reads ahead
+  AsyncEngine *m_engine;
   RelationKind m_kind;
+  const TableOptions &m_options;
+  TableStats &m_stats;
+
+  RpcCounters &Counters() { return m_stats.Rpc(RpcKind::Relations); }
   bool m_eof = false;
   std::unique_ptr<IResultStream<Relation>> m_stream = nullptr;
+  // Number of rows that SQLite can still consume, or -1 if unbounded
+  sqlite3_int64 m_remaining = -1;
+  ScanRecorder m_scan;
+  QueryPlan m_plan;
+
+  // The ids of the objects of every subject probed by the statement, so that
+  // probing the same subject again doesn't need another call
+  std::unordered_map<std::string, std::vector<std::string>> m_memo;
+  size_t m_memoRows = 0;
+  // Whether the relations of `m_memoSubject` are being recorded in
+  // `m_recorded` while being read
+  bool m_recording = false;
+  std::string m_memoSubject;
+  std::vector<std::string> m_recorded;
 
+  // Kept across calls to Filter, so that probes answered from the memo don't
+  // allocate
   std::vector<std::string> m_subjects;
+  StreamPool<MemoStream, Relation> m_memoPool;
+
+  RelationsRequest MakeRequest(const std::vector<std::string> &subjects) {
+    RelationsRequest req;
+    req.set_predicate(m_kind);
+    for (const auto &subject : subjects) {
+      req.add_subjects(subject);
+    }
+    if (m_remaining > 0) {
+      req.set_limit(MaxLimit());
+    }
+    if (m_options.page_size) {
+      SetFirstPage(req, m_options.page_size);
+    }
+    return req;
+  }
+
+  // Number of relations needed from the server
+  uint32_t MaxLimit() {
+    if (m_remaining > 0) {
+      return (uint32_t)std::min<sqlite3_int64>(m_remaining, UINT32_MAX);
+    }
+    return UINT32_MAX;
+  }
+
+  void Record() {
+    if (m_eof) {
+      // Results of a call that failed, or that the server cut short, would
+      // answer later probes wrongly
+      if (m_stream->Ok() && !m_stream->HasMore()) {
+        m_memoRows += m_recorded.size();
+        m_memo[m_memoSubject] = std::move(m_recorded);
+      }
+      m_recorded.clear();
+      m_recording = false;
+    } else if (m_memoRows + m_recorded.size() < relations_memo_capacity) {
+      m_recorded.push_back(m_stream->Current().object().id());
+    } else {
+      m_recording = false;
+      m_recorded.clear();
+    }
+  }
 
 public:
-  RelationsCursor(SymbolIndex::Stub &stub, RelationKind kind)
-    : m_stub(stub), m_kind(kind) {}
+  RelationsCursor(IndexBackend &backend, SymbolCache &cache,
+                  AsyncEngine *engine, RelationKind kind,
+                  const TableOptions &options, TableStats &stats)
+    : m_backend(backend), m_cache(cache), m_engine(engine), m_kind(kind),
+      m_options(options), m_stats(stats) {}
 
   int Eof() override { return m_eof; }
 
   int Next() override {
+    if (m_remaining == 0) {
+      m_eof = true;
+      return SQLITE_OK;
+    }
+
     m_eof = !m_stream->Next();
+    if (m_eof) {
+      m_scan.Finish();
+    } else {
+      m_scan.Row();
+    }
+    if (m_recording) {
+      Record();
+    }
+    if (!m_eof && m_remaining > 0 && --m_remaining == 0) {
+      // SQLite is not going to ask for more rows than this, so let the server
+      // know it can stop sending them
+      m_stream->Cancel();
+    }
     return SQLITE_OK;
   }
 
   sqlite3_int64 RowId() override {
-    auto a = strtoll(m_stream->Current().subject_id().c_str(), nullptr, 16);
-    auto b = strtoll(m_stream->Current().object().id().c_str(), nullptr, 16);
+    uint64_t a = 0, b = 0;
+    ParseSymbolId(m_stream->Current().subject_id(), a);
+    ParseSymbolId(m_stream->Current().object().id(), b);
 
     // Use Cantor's pairing function to generate a new unique id from two unique
     // ids
     auto t = a + b;
-    return (t >> 1) * (t + 1) + b;
+    return (sqlite3_int64)((t >> 1) * (t + 1) + b);
   }
 
   int Column(sqlite3_context *ctx, int idxCol) override {
     switch (idxCol) {
     case 0:
-      sqlite3_result_text(ctx, m_stream->Current().subject_id().c_str(), -1,
-                          SQLITE_TRANSIENT);
+      ResultText(ctx, m_stream->Current().subject_id());
       break;
     case 1:
-      sqlite3_result_text(ctx, m_stream->Current().object().id().c_str(), -1,
-                          SQLITE_TRANSIENT);
+      ResultText(ctx, m_stream->Current().object().id());
       break;
     }
     return SQLITE_OK;
@@ -72,17 +211,89 @@ public:
 
   int Filter(int idxNum, const char *idxStr, int argc,
              sqlite3_value **argv) override {
-    if (idxNum) {
-      m_subjects.push_back((const char *)sqlite3_value_text(argv[0]));
+    // Cancel whatever was still running before starting the new call
+    m_memoPool.Recycle(m_stream);
+    m_recording = false;
+    m_recorded.clear();
+    m_scan.Abandon();
+    if (!m_plan.Parse(idxStr)) {
+      return SQLITE_ERROR;
     }
 
-    RelationsRequest req;
-    req.set_predicate(m_kind);
-    for (const auto &subj : m_subjects) {
-      req.add_subjects(subj);
+    int argIndex = 0;
+    auto &subjects = m_subjects;
+    if (auto subject = m_plan.Find("subject")) {
+      TextValues(argv[argIndex++], subject->op == PlanOp::In, subjects);
+    } else {
+      subjects.clear();
+    }
+
+    m_remaining = RowLimit(m_plan, argv, argIndex);
+    // Relations are only ever looked up by subject
+    if (m_remaining == 0 || subjects.empty()) {
+      m_eof = true;
+      return SQLITE_OK;
     }
+    if (m_remaining < 0) {
+      m_scan.Start(AccessPath::RelationsBySubject, subjects.size());
+    }
+
+    // Nested loops probe one subject at a time, possibly the same one again
+    // and again. Only complete results can answer a later probe.
+    bool probe = subjects.size() == 1 && m_remaining < 0;
+    if (probe) {
+      auto it = m_memo.find(subjects[0]);
+      if (it != m_memo.end()) {
+        Counters().cacheHits.fetch_add(1, std::memory_order_relaxed);
+        auto memo = m_memoPool.Take();
+        memo->Reset(it->first, it->second);
+        m_stream = std::move(memo);
+        return Next();
+      }
+      Counters().cacheMisses.fetch_add(1, std::memory_order_relaxed);
+      m_recording = true;
+      m_memoSubject = subjects[0];
+    }
+
+    auto req = MakeRequest(subjects);
+    if (m_engine) {
+      // The call may have been started when another table announced the
+      // subject
+      m_stream = m_engine->Take(req);
+    }
+    if (!m_stream) {
+      m_stream = std::make_unique<RelationStream>(
+       m_backend.Relations(req, Counters()), m_cache);
+    }
+    if (m_options.page_size) {
+      m_stream = std::make_unique<PagedStream<RelationsRequest, Relation>>(
+       req, MaxLimit(),
+       [this](const RelationsRequest &page)
+        -> std::unique_ptr<IResultStream<Relation>> {
+         return std::make_unique<RelationStream>(
+          m_backend.Relations(page, Counters()), m_cache);
+       },
+       relation_key, std::move(m_stream));
+    }
+    m_stream = WithPrefetch(std::move(m_stream), m_options.prefetch);
 
-    m_stream = std::make_unique<RelationStream>(m_stub, req);
+    if (m_engine && probe) {
+      for (auto &subject :
+           m_engine->Upcoming(subjects[0], m_options.lookahead)) {
+        if (!m_memo.count(subject)) {
+          m_engine->Start(MakeRequest({subject}), Counters());
+        }
+      }
+    }
+    if (m_engine) {
+      // Objects are what gets joined against other tables
+      m_stream = WithLookahead<Relation>(
+       std::move(m_stream), *m_engine,
+       [](const Relation &rel) -> const std::string & {
+         return rel.object().id();
+       },
+       m_options.lookahead);
+    }
     return Next();
   }
 };
@@ -90,28 +301,48 @@ public:
 constexpr const char *schema = "CREATE TABLE vtable(Subject TEXT, Object TEXT)";
 
 RelationsTable::RelationsTable(sqlite3 *db,
-                               std::unique_ptr<SymbolIndex::Stub> stub,
-                               RelationKind kind)
-  : m_stub(std::move(stub)), m_kind(kind) {
+                               std::shared_ptr<IndexBackend> backend,
+                               std::shared_ptr<SymbolCache> cache,
+                               std::shared_ptr<AsyncEngine> engine,
+                               RelationKind kind, const TableOptions &options,
+                               std::shared_ptr<TableStats> stats)
+  : m_backend(std::move(backend)), m_cache(std::move(cache)),
+    m_engine(std::move(engine)), m_kind(kind), m_options(options),
+    m_stats(std::move(stats)) {
   if (sqlite3_declare_vtab(db, schema) != SQLITE_OK) {
     throw std::exception();
   }
 }
 
 int RelationsTable::BestIndex(sqlite3_index_info *info) {
+  QueryPlan plan;
+  plan.call = "Relations";
+  int argvIndex = 0;
+
   for (int i = 0; i < info->nConstraint; i++) {
     auto constraint = info->aConstraint[i];
     if (constraint.usable && constraint.iColumn == 0 &&
         constraint.op == SQLITE_INDEX_CONSTRAINT_EQ) {
-      info->aConstraintUsage[i].argvIndex = 1;
-      info->estimatedCost = 1;
-      info->idxNum = 1;
-      return SQLITE_OK;
+      info->aConstraintUsage[i].argvIndex = ++argvIndex;
+      // Every row has one of the requested subjects
+      info->aConstraintUsage[i].omit = 1;
+      bool isIn = CanProcessInAllAtOnce() && sqlite3_vtab_in(info, i, 1);
+      plan.Add("subject", isIn ? PlanOp::In : PlanOp::Eq);
+      break;
     }
   }
 
+  // Without a subject there is nothing to ask the server
+  SetEstimates(info,
+               plan.Find("subject") ? AccessPath::RelationsBySubject
+                                    : AccessPath::Unusable,
+               false);
+  UseLimitOffset(info, argvIndex, plan);
+  SetPlan(info, plan);
+
   return SQLITE_OK;
 }
 std::unique_ptr<VirtualTableCursor> RelationsTable::Open() {
-  return std::make_unique<RelationsCursor>(*m_stub, m_kind);
+  return std::make_unique<RelationsCursor>(*m_backend, *m_cache, m_engine.get(),
+                                           m_kind, m_options, *m_stats);
 }
\ No newline at end of file
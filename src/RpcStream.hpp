@@ -0,0 +1,95 @@
+#ifndef RPCSTREAM_HPP
+#define RPCSTREAM_HPP
+#include "IResultStream.hpp"
+#include "Statistics.hpp"
+#include "Trace.hpp"
+#include <grpcpp/grpcpp.h>
+
+#include <memory>
+
+// Result stream backed by a server-streaming call. Replies are expected to
+// carry results in `stream_result`, terminated by a `final_result` message.
+//
+// If the stream is destroyed before the server is done, the call is cancelled
+// and whatever was still buffered is drained and accounted for in the
+// counters of the RPC, so neither side keeps working for results nobody reads.
+template <typename Reply, typename T>
+class RpcStream : public IResultStream<T> {
+  CallRecorder m_recorder;
+  bool m_done = false;
+  bool m_hasMore = false;
+  bool m_ok = false;
+
+protected:
+  grpc::ClientContext m_ctx;
+  std::unique_ptr<grpc::ClientReader<Reply>> m_replyReader;
+  Reply m_reply;
+
+  // Subclasses start the call on `m_ctx` and store it in `m_replyReader`
+  RpcStream(RpcCounters &counters) : m_recorder(counters) {}
+
+public:
+  ~RpcStream() override {
+    if (!m_replyReader) {
+      return;
+    }
+
+    if (!m_done) {
+      m_ctx.TryCancel();
+
+      auto &counters = m_recorder.Counters();
+      counters.cancelled++;
+      while (m_replyReader->Read(&m_reply)) {
+        counters.discardedMessages++;
+        counters.discardedBytes += m_reply.ByteSizeLong();
+      }
+    }
+    auto status = m_replyReader->Finish();
+    m_recorder.Finish(status.ok(),
+                      status.error_code() == grpc::StatusCode::CANCELLED);
+  }
+
+  const T &Current() override { return m_reply.stream_result(); }
+
+  bool Next() override {
+    if (m_done) {
+      return false;
+    }
+
+    bool gotReply;
+    {
+      // Receiving and parsing a reply
+      TraceSpan span("rpc", "read");
+      gotReply = m_replyReader->Read(&m_reply);
+    }
+    if (gotReply) {
+      m_recorder.Message(m_reply.ByteSizeLong());
+      if (m_reply.has_stream_result()) {
+        return true;
+      }
+
+      m_hasMore = m_reply.final_result().has_more();
+      m_ok = true;
+      // The final result is the last message, so the server is done
+      m_done = !m_replyReader->Read(&m_reply);
+    } else {
+      m_done = true;
+    }
+    if (m_done) {
+      m_recorder.Done();
+    }
+    return false;
+  }
+
+  void Cancel() override { m_ctx.TryCancel(); }
+
+  bool HasMore() override { return m_hasMore; }
+
+  bool Ok() override { return m_ok; }
+
+  void MoveCurrent(T &dest) override {
+    dest.Swap(m_reply.mutable_stream_result());
+  }
+};
+
+#endif
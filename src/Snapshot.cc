@@ -0,0 +1,1136 @@
+#include "Snapshot.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace clang::clangd::remote;
+
+// Snapshots start with a header giving the place of each column in the file.
+// Columns are arrays of native integers aligned on 8 bytes: strings are
+// indices in the dictionary, symbols are row numbers, and a list per symbol is
+// stored as the offsets of each symbol's first element, followed by the
+// offset of the end. Symbols are sorted by id, and the dictionary by bytes.
+constexpr char snapshot_magic[8] = {'C', 'Q', 'L', 'S', 'N', 'A', 'P', '1'};
+constexpr uint32_t snapshot_byte_order = 0x01020304;
+
+// Stands for a string that is not set
+constexpr uint32_t no_string = UINT32_MAX;
+
+enum SnapshotColumn {
+  // Offsets of the strings in StringData, followed by the end of the last one
+  StringOffsets,
+  StringData,
+
+  SymbolId,
+  SymbolName,
+  SymbolScope,
+  SymbolSignature,
+  SymbolDocumentation,
+  SymbolReturnType,
+  SymbolType,
+  SymbolTemplateArgs,
+  SymbolSnippetSuffix,
+  // The definition and declaration, whose columns follow the order of
+  // LocationColumn
+  SymbolDefinition,
+  SymbolDeclaration = SymbolDefinition + 5,
+  // Which of the fields below are set, as bits in the order of SymbolNumber
+  SymbolNumbersSet = SymbolDeclaration + 5,
+  SymbolKind,
+  SymbolSubKind,
+  SymbolLanguage,
+  SymbolProperties,
+  SymbolReferences,
+  SymbolOrigin,
+  SymbolFlags,
+  // Row numbers of the symbols, ordered by name and by scope
+  SymbolsByName,
+  SymbolsByScope,
+
+  RefOffsets,
+  RefKind,
+  RefLocation,
+
+  // Offsets of the objects of each subject, then the row number of each
+  // object, for each kind of relation
+  RelationOffsets = RefLocation + 5,
+  RelationObjects,
+
+  num_snapshot_columns = RelationObjects + 3
+};
+
+// Columns of a location, relative to its first column. Positions of
+// locations that are set are always set.
+enum LocationColumn {
+  LocationPath,
+  LocationStartLine,
+  LocationStartColumn,
+  LocationEndLine,
+  LocationEndColumn
+};
+
+// Fields of symbols that may be unset, as bits of SymbolNumbersSet
+enum SymbolNumber {
+  InfoSet,
+  ReferencesSet,
+  OriginSet,
+  FlagsSet,
+  DefinitionSet,
+  DeclarationSet,
+  KindSet,
+  SubKindSet,
+  LanguageSet,
+  PropertiesSet
+};
+
+constexpr int num_relation_kinds = 2;
+
+// Text fields of symbols
+struct TextField {
+  SnapshotColumn column;
+  bool (Symbol::*has)() const;
+  const std::string &(Symbol::*get)() const;
+  std::string *(Symbol::*mutate)();
+};
+
+static const TextField text_fields[] = {
+ {SymbolName, &Symbol::has_name, &Symbol::name, &Symbol::mutable_name},
+ {SymbolScope, &Symbol::has_scope, &Symbol::scope, &Symbol::mutable_scope},
+ {SymbolSignature, &Symbol::has_signature, &Symbol::signature,
+  &Symbol::mutable_signature},
+ {SymbolDocumentation, &Symbol::has_documentation, &Symbol::documentation,
+  &Symbol::mutable_documentation},
+ {SymbolReturnType, &Symbol::has_return_type, &Symbol::return_type,
+  &Symbol::mutable_return_type},
+ {SymbolType, &Symbol::has_type, &Symbol::type, &Symbol::mutable_type},
+ {SymbolTemplateArgs, &Symbol::has_template_specialization_args,
+  &Symbol::template_specialization_args,
+  &Symbol::mutable_template_specialization_args},
+ {SymbolSnippetSuffix, &Symbol::has_completion_snippet_suffix,
+  &Symbol::completion_snippet_suffix,
+  &Symbol::mutable_completion_snippet_suffix},
+};
+
+struct SnapshotSection {
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t byteOrder;
+  uint32_t numColumns;
+  SnapshotSection columns[num_snapshot_columns];
+};
+
+// Whether the characters of `query` appear in `name` in order, ignoring case,
+// which is what clangd's fuzzy matcher requires of a match before ranking it
+static bool fuzzy_matches(const std::string &query, const char *name,
+                          size_t size) {
+  size_t next = 0;
+  for (size_t i = 0; i < size && next < query.size(); i++) {
+    if (std::tolower((unsigned char)name[i]) ==
+        std::tolower((unsigned char)query[next])) {
+      next++;
+    }
+  }
+  return next == query.size();
+}
+
+// Everything found by a crawl, with the symbols sorted by id
+struct CrawledIndex {
+  std::vector<Symbol> symbols;
+  std::vector<std::vector<Ref>> refs;
+  std::vector<std::vector<uint32_t>> relations[num_relation_kinds];
+};
+
+// Builds the columns of a snapshot in memory
+class SnapshotWriter {
+  const CrawledIndex &m_index;
+  std::vector<const std::string *> m_strings;
+  std::vector<std::string> m_columns;
+
+  template <typename T> void Append(int column, T value) {
+    m_columns[column].append((const char *)&value, sizeof(value));
+  }
+
+  uint32_t StringIndex(const std::string &string) const {
+    auto it = std::lower_bound(
+     m_strings.begin(), m_strings.end(), &string,
+     [](const std::string *a, const std::string *b) { return *a < *b; });
+    return (uint32_t)(it - m_strings.begin());
+  }
+
+  // Returns the index appended
+  uint32_t AppendString(int column, bool set, const std::string &string) {
+    auto index = set ? StringIndex(string) : no_string;
+    Append<uint32_t>(column, index);
+    return index;
+  }
+
+  void AppendLocation(int column, bool set, const SymbolLocation &location) {
+    AppendString(column + LocationPath, set, location.file_path());
+    Append<uint32_t>(column + LocationStartLine, location.start().line());
+    Append<uint32_t>(column + LocationStartColumn, location.start().column());
+    Append<uint32_t>(column + LocationEndLine, location.end().line());
+    Append<uint32_t>(column + LocationEndColumn, location.end().column());
+  }
+
+  void BuildDictionary() {
+    for (auto &symbol : m_index.symbols) {
+      m_strings.push_back(&symbol.id());
+      for (auto &field : text_fields) {
+        m_strings.push_back(&(symbol.*field.get)());
+      }
+      m_strings.push_back(&symbol.definition().file_path());
+      m_strings.push_back(&symbol.canonical_declaration().file_path());
+    }
+    for (auto &refs : m_index.refs) {
+      for (auto &ref : refs) {
+        m_strings.push_back(&ref.location().file_path());
+      }
+    }
+    std::sort(
+     m_strings.begin(), m_strings.end(),
+     [](const std::string *a, const std::string *b) { return *a < *b; });
+    m_strings.erase(
+     std::unique(
+      m_strings.begin(), m_strings.end(),
+      [](const std::string *a, const std::string *b) { return *a == *b; }),
+     m_strings.end());
+    if (m_strings.size() >= no_string) {
+      throw std::runtime_error("Too many strings for a snapshot");
+    }
+
+    uint64_t offset = 0;
+    for (auto string : m_strings) {
+      Append<uint64_t>(StringOffsets, offset);
+      m_columns[StringData] += *string;
+      offset += string->size();
+    }
+    Append<uint64_t>(StringOffsets, offset);
+  }
+
+  void BuildSymbols() {
+    std::vector<uint32_t> names, scopes;
+    for (auto &symbol : m_index.symbols) {
+      AppendString(SymbolId, true, symbol.id());
+      for (auto &field : text_fields) {
+        auto index = AppendString(field.column, (symbol.*field.has)(),
+                                  (symbol.*field.get)());
+        if (field.column == SymbolName) {
+          names.push_back(index);
+        } else if (field.column == SymbolScope) {
+          scopes.push_back(index);
+        }
+      }
+
+      AppendLocation(SymbolDefinition, symbol.has_definition(),
+                     symbol.definition());
+      AppendLocation(SymbolDeclaration, symbol.has_canonical_declaration(),
+                     symbol.canonical_declaration());
+      uint32_t set = (uint32_t)symbol.has_info() << InfoSet |
+                     (uint32_t)symbol.has_references() << ReferencesSet |
+                     (uint32_t)symbol.has_origin() << OriginSet |
+                     (uint32_t)symbol.has_flags() << FlagsSet |
+                     (uint32_t)symbol.has_definition() << DefinitionSet |
+                     (uint32_t)symbol.has_canonical_declaration()
+                      << DeclarationSet |
+                     (uint32_t)symbol.info().has_kind() << KindSet |
+                     (uint32_t)symbol.info().has_subkind() << SubKindSet |
+                     (uint32_t)symbol.info().has_language() << LanguageSet |
+                     (uint32_t)symbol.info().has_properties()
+                      << PropertiesSet;
+      Append<uint32_t>(SymbolNumbersSet, set);
+      Append<uint32_t>(SymbolKind, symbol.info().kind());
+      Append<uint32_t>(SymbolSubKind, symbol.info().subkind());
+      Append<uint32_t>(SymbolLanguage, symbol.info().language());
+      Append<uint32_t>(SymbolProperties, symbol.info().properties());
+      Append<uint32_t>(SymbolReferences, (uint32_t)symbol.references());
+      Append<uint32_t>(SymbolOrigin, symbol.origin());
+      Append<uint32_t>(SymbolFlags, symbol.flags());
+    }
+
+    for (auto &order : {std::make_pair(SymbolsByName, &names),
+                        std::make_pair(SymbolsByScope, &scopes)}) {
+      auto &keys = *order.second;
+      std::vector<uint32_t> rows(keys.size());
+      for (uint32_t i = 0; i < rows.size(); i++) {
+        rows[i] = i;
+      }
+      std::stable_sort(rows.begin(), rows.end(), [&](uint32_t a, uint32_t b) {
+        return keys[a] < keys[b];
+      });
+      for (auto row : rows) {
+        Append<uint32_t>(order.first, row);
+      }
+    }
+  }
+
+  void BuildRefs() {
+    uint64_t offset = 0;
+    for (auto &refs : m_index.refs) {
+      Append<uint64_t>(RefOffsets, offset);
+      for (auto &ref : refs) {
+        Append<uint32_t>(RefKind, ref.kind());
+        AppendLocation(RefLocation, true, ref.location());
+      }
+      offset += refs.size();
+    }
+    Append<uint64_t>(RefOffsets, offset);
+  }
+
+  void BuildRelations() {
+    for (int kind = 0; kind < num_relation_kinds; kind++) {
+      uint64_t offset = 0;
+      for (auto &objects : m_index.relations[kind]) {
+        Append<uint64_t>(RelationOffsets + 2 * kind, offset);
+        for (auto object : objects) {
+          Append<uint32_t>(RelationObjects + 2 * kind, object);
+        }
+        offset += objects.size();
+      }
+      Append<uint64_t>(RelationOffsets + 2 * kind, offset);
+    }
+  }
+
+public:
+  explicit SnapshotWriter(const CrawledIndex &index)
+    : m_index(index), m_columns(num_snapshot_columns) {
+    BuildDictionary();
+    BuildSymbols();
+    BuildRefs();
+    BuildRelations();
+  }
+
+  // Writes the snapshot to a temporary file that then replaces `path`, so
+  // that tables reading the previous snapshot are not disturbed
+  void Write(const std::string &path) const {
+    SnapshotHeader header = {};
+    std::copy(snapshot_magic, snapshot_magic + sizeof(snapshot_magic),
+              header.magic);
+    header.byteOrder = snapshot_byte_order;
+    header.numColumns = num_snapshot_columns;
+    uint64_t offset = (sizeof(header) + 7) & ~7ULL;
+    for (int i = 0; i < num_snapshot_columns; i++) {
+      header.columns[i] = {offset, m_columns[i].size()};
+      offset = (offset + m_columns[i].size() + 7) & ~7ULL;
+    }
+
+    auto tmp = path + ".tmp";
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    file.write((const char *)&header, sizeof(header));
+    const char padding[8] = {};
+    file.write(padding, (std::streamsize)(-sizeof(header) & 7));
+    for (auto &column : m_columns) {
+      file.write(column.data(), (std::streamsize)column.size());
+      file.write(padding, (std::streamsize)(-column.size() & 7));
+    }
+    file.close();
+    if (!file || std::rename(tmp.c_str(), path.c_str()) != 0) {
+      std::remove(tmp.c_str());
+      throw std::runtime_error("Cannot write " + path);
+    }
+  }
+};
+
+// Number of results asked for by each search of a crawl
+constexpr uint32_t crawl_page_size = 1 << 14;
+
+// Number of results asked for by the searches in any scope that start a
+// crawl, of which only the scopes are used
+constexpr uint32_t crawl_probe_size = 1 << 12;
+
+// Searches for names with a prefix this long are not split any further
+constexpr size_t crawl_max_prefix = 32;
+
+// Number of subjects sent in each Relations call of a crawl
+constexpr int crawl_relations_batch = 256;
+
+// Characters that names are split by when a scope has too many symbols.
+// Names are matched ignoring case, so there are no upper case letters.
+static std::string name_characters() {
+  std::string res;
+  for (char c = ' '; c <= '~'; c++) {
+    if (!std::isupper((unsigned char)c)) {
+      res += c;
+    }
+  }
+  return res;
+}
+
+// Kinds of the symbols that have members
+static bool has_members(uint32_t kind) {
+  // Namespace, Enum, Struct, Class, Protocol, Extension and Union
+  return kind == 2 || (kind >= 5 && kind <= 10);
+}
+
+// Searches by name in a scope, or in any scope
+struct CrawlSearch {
+  bool anyScope;
+  std::string scope;
+  std::string prefix;
+};
+
+// Calls `fn(i)` for every `i` below `n`, from `threads` threads
+template <typename Fn>
+static void parallel_for(size_t n, size_t threads, const Fn &fn) {
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; i++) {
+    workers.emplace_back([&]() {
+      for (size_t j; (j = next.fetch_add(1)) < n;) {
+        fn(j);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+class IndexCrawler {
+  IndexBackend &m_backend;
+  TableStats &m_stats;
+  size_t m_threads;
+  std::string m_characters = name_characters();
+
+  std::mutex m_mutex;
+  std::condition_variable m_idle;
+  std::deque<CrawlSearch> m_searches;
+  // Number of searches being made
+  size_t m_busy = 0;
+  std::unordered_set<std::string> m_scopes;
+  std::unordered_map<std::string, Symbol> m_symbols;
+
+  void AddScope(const std::string &scope) {
+    if (m_scopes.insert(scope).second) {
+      m_searches.push_back({false, scope, ""});
+    }
+  }
+
+  // Searches the scopes that `symbol` reveals
+  void AddScopes(const Symbol &symbol) {
+    // Every enclosing scope, such as `a::` and `a::b::` for `a::b::`
+    auto &scope = symbol.scope();
+    for (auto end = scope.find("::"); end != std::string::npos;
+         end = scope.find("::", end + 2)) {
+      AddScope(scope.substr(0, end + 2));
+    }
+    if (has_members(symbol.info().kind())) {
+      AddScope(scope + symbol.name() + "::");
+    }
+  }
+
+  // Keeps `symbol` unless it was already found
+  void AddSymbol(Symbol &symbol) {
+    if (!symbol.has_id() || m_symbols.count(symbol.id())) {
+      return;
+    }
+    AddScopes(symbol);
+    auto id = symbol.id();
+    m_symbols[id].Swap(&symbol);
+  }
+
+  void Search(const CrawlSearch &search) {
+    FuzzyFindRequest req;
+    req.set_query(search.prefix);
+    req.set_limit(search.anyScope ? crawl_probe_size : crawl_page_size);
+    req.set_any_scope(search.anyScope);
+    if (!search.anyScope) {
+      req.add_scopes(search.scope);
+    }
+
+    // Searches in any scope are only there to find scopes, so they don't
+    // need the other fields
+    auto &counters = m_stats.Rpc(RpcKind::FuzzyFind);
+    std::unique_ptr<IResultStream<Symbol>> stream;
+    if (search.anyScope) {
+      stream = m_backend.FuzzyFindFields(
+       req,
+       symbol_field(Symbol::kIdFieldNumber) |
+        symbol_field(Symbol::kNameFieldNumber) |
+        symbol_field(Symbol::kScopeFieldNumber) |
+        symbol_field(Symbol::kInfoFieldNumber),
+       counters);
+    }
+    if (!stream) {
+      stream = m_backend.FuzzyFind(req, counters);
+    }
+    std::vector<Symbol> symbols;
+    while (stream->Next()) {
+      symbols.emplace_back();
+      stream->MoveCurrent(symbols.back());
+    }
+    auto hasMore = stream->HasMore();
+    stream = nullptr;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &symbol : symbols) {
+      if (search.anyScope) {
+        AddScopes(symbol);
+      } else {
+        AddSymbol(symbol);
+      }
+    }
+    if (hasMore && !search.anyScope &&
+        search.prefix.size() < crawl_max_prefix) {
+      for (auto c : m_characters) {
+        m_searches.push_back({false, search.scope, search.prefix + c});
+      }
+    }
+  }
+
+  void FindSymbols() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+      m_idle.wait(lock, [&]() { return !m_searches.empty() || m_busy == 0; });
+      if (m_searches.empty()) {
+        break;
+      }
+      auto search = std::move(m_searches.front());
+      m_searches.pop_front();
+      m_busy++;
+      lock.unlock();
+      Search(search);
+      lock.lock();
+      m_busy--;
+      m_idle.notify_all();
+    }
+  }
+
+public:
+  IndexCrawler(IndexBackend &backend, TableStats &stats, size_t threads)
+    : m_backend(backend), m_stats(stats), m_threads(threads) {}
+
+  CrawledIndex Crawl() {
+    // The best symbols of the whole index, and of each initial, have scopes
+    // to start from
+    m_searches.push_back({true, "", ""});
+    for (char c = 'a'; c <= 'z'; c++) {
+      m_searches.push_back({true, "", std::string(1, c)});
+    }
+    AddScope("");
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < m_threads; i++) {
+      workers.emplace_back([this]() { FindSymbols(); });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+
+    // The objects of relations may not have been found, so relations are
+    // crawled before the references of every symbol
+    std::unordered_map<std::string, std::vector<std::string>>
+     objects[num_relation_kinds];
+    std::vector<std::string> ids;
+    for (auto &symbol : m_symbols) {
+      ids.push_back(symbol.first);
+    }
+    for (int kind = 0; kind < num_relation_kinds; kind++) {
+      auto batches = (ids.size() + crawl_relations_batch - 1) /
+                     crawl_relations_batch;
+      parallel_for(batches, m_threads, [&](size_t batch) {
+        RelationsRequest req;
+        req.set_predicate(kind);
+        for (size_t i = batch * crawl_relations_batch;
+             i < ids.size() && i < (batch + 1) * crawl_relations_batch; i++) {
+          req.add_subjects(ids[i]);
+        }
+        std::vector<Relation> relations;
+        auto stream =
+         m_backend.Relations(req, m_stats.Rpc(RpcKind::Relations));
+        while (stream->Next()) {
+          relations.emplace_back();
+          stream->MoveCurrent(relations.back());
+        }
+        stream = nullptr;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &relation : relations) {
+          objects[kind][relation.subject_id()].push_back(
+           relation.object().id());
+          AddSymbol(*relation.mutable_object());
+        }
+      });
+    }
+
+    CrawledIndex index;
+    index.symbols.reserve(m_symbols.size());
+    for (auto &symbol : m_symbols) {
+      index.symbols.emplace_back();
+      index.symbols.back().Swap(&symbol.second);
+    }
+    m_symbols.clear();
+    std::sort(index.symbols.begin(), index.symbols.end(),
+              [](const Symbol &a, const Symbol &b) { return a.id() < b.id(); });
+
+    // References don't say what they refer to, so there is one call per
+    // symbol
+    index.refs.resize(index.symbols.size());
+    parallel_for(index.symbols.size(), m_threads, [&](size_t i) {
+      RefsRequest req;
+      req.add_ids(index.symbols[i].id());
+      req.set_filter(UINT32_MAX);
+      auto stream = m_backend.Refs(req, m_stats.Rpc(RpcKind::Refs));
+      while (stream->Next()) {
+        index.refs[i].emplace_back();
+        stream->MoveCurrent(index.refs[i].back());
+      }
+    });
+
+    std::unordered_map<std::string, uint32_t> rows;
+    for (uint32_t i = 0; i < index.symbols.size(); i++) {
+      rows[index.symbols[i].id()] = i;
+    }
+    for (int kind = 0; kind < num_relation_kinds; kind++) {
+      index.relations[kind].resize(index.symbols.size());
+      for (auto &subject : objects[kind]) {
+        auto row = rows.find(subject.first);
+        if (row == rows.end()) {
+          continue;
+        }
+        for (auto &object : subject.second) {
+          auto objectRow = rows.find(object);
+          if (objectRow != rows.end()) {
+            index.relations[kind][row->second].push_back(objectRow->second);
+          }
+        }
+      }
+    }
+    return index;
+  }
+};
+
+size_t WriteSnapshot(IndexBackend &backend, TableStats &stats,
+                     const std::string &path, size_t threads) {
+  uint64_t errors = 0;
+  for (auto &counters : stats.rpcs) {
+    errors -= counters.errors;
+  }
+  auto index = IndexCrawler(backend, stats, threads).Crawl();
+  for (auto &counters : stats.rpcs) {
+    errors += counters.errors;
+  }
+  if (errors > 0) {
+    throw std::runtime_error(std::to_string(errors) +
+                             " calls failed while crawling the index");
+  }
+
+  SnapshotWriter(index).Write(path);
+  return index.symbols.size();
+}
+
+// A snapshot mapped in memory
+class SnapshotFile {
+  const char *m_data = nullptr;
+  size_t m_size = 0;
+#ifdef _WIN32
+  std::string m_contents;
+#endif
+  SnapshotHeader m_header;
+
+public:
+  size_t numSymbols;
+  size_t numStrings;
+
+  explicit SnapshotFile(const std::string &path) {
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      throw std::runtime_error("Cannot read " + path);
+    }
+    m_contents.assign(std::istreambuf_iterator<char>(file),
+                      std::istreambuf_iterator<char>());
+    m_data = m_contents.data();
+    m_size = m_contents.size();
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      if (fd >= 0) {
+        close(fd);
+      }
+      throw std::runtime_error("Cannot read " + path);
+    }
+    m_size = (size_t)st.st_size;
+    if (m_size > 0) {
+      auto data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+      m_data = data == MAP_FAILED ? nullptr : (const char *)data;
+    }
+    close(fd);
+    if (!m_data) {
+      throw std::runtime_error("Cannot map " + path);
+    }
+#endif
+
+    try {
+      Validate(path);
+    } catch (...) {
+      Unmap();
+      throw;
+    }
+  }
+
+  ~SnapshotFile() { Unmap(); }
+
+  void Unmap() {
+#ifndef _WIN32
+    if (m_data) {
+      munmap((void *)m_data, m_size);
+    }
+#endif
+    m_data = nullptr;
+  }
+
+  template <typename T> const T *Column(int column) const {
+    return (const T *)(m_data + m_header.columns[column].offset);
+  }
+
+  template <typename T> size_t ColumnSize(int column) const {
+    return m_header.columns[column].size / sizeof(T);
+  }
+
+  // Checks that every column has the expected size and refers to existing
+  // strings and symbols, so that no query can read outside of the file
+  void Validate(const std::string &path) {
+    auto invalid = [&]() {
+      return std::runtime_error(path + " is not a valid snapshot");
+    };
+    if (m_size < sizeof(m_header)) {
+      throw invalid();
+    }
+    std::memcpy(&m_header, m_data, sizeof(m_header));
+    if (!std::equal(snapshot_magic, snapshot_magic + sizeof(snapshot_magic),
+                    m_header.magic) ||
+        m_header.byteOrder != snapshot_byte_order ||
+        m_header.numColumns != num_snapshot_columns) {
+      throw invalid();
+    }
+    for (auto &section : m_header.columns) {
+      if (section.offset % 8 || section.offset > m_size ||
+          section.size > m_size - section.offset) {
+        throw invalid();
+      }
+    }
+
+    // Offsets are checked to grow up to the size of what they point into
+    auto checkOffsets = [&](int column, size_t count, size_t end) {
+      auto offsets = Column<uint64_t>(column);
+      if (ColumnSize<uint64_t>(column) != count + 1 || offsets[0] != 0 ||
+          offsets[count] != end) {
+        throw invalid();
+      }
+      for (size_t i = 0; i < count; i++) {
+        if (offsets[i] > offsets[i + 1]) {
+          throw invalid();
+        }
+      }
+    };
+    auto checkSize = [&](int column, size_t count) {
+      if (ColumnSize<uint32_t>(column) != count) {
+        throw invalid();
+      }
+    };
+    auto checkValues = [&](int column, size_t count, uint32_t bound,
+                           bool allowUnset) {
+      checkSize(column, count);
+      auto values = Column<uint32_t>(column);
+      for (size_t i = 0; i < count; i++) {
+        if (values[i] >= bound && !(allowUnset && values[i] == no_string)) {
+          throw invalid();
+        }
+      }
+    };
+
+    numStrings = ColumnSize<uint64_t>(StringOffsets);
+    if (numStrings == 0 || numStrings > no_string) {
+      throw invalid();
+    }
+    numStrings--;
+    checkOffsets(StringOffsets, numStrings, m_header.columns[StringData].size);
+
+    numSymbols = ColumnSize<uint32_t>(SymbolId);
+    checkValues(SymbolId, numSymbols, (uint32_t)numStrings, false);
+    auto ids = Column<uint32_t>(SymbolId);
+    for (size_t i = 1; i < numSymbols; i++) {
+      if (ids[i - 1] >= ids[i]) {
+        throw invalid();
+      }
+    }
+    for (auto &field : text_fields) {
+      checkValues(field.column, numSymbols, (uint32_t)numStrings, true);
+    }
+    for (int column : {SymbolDefinition, SymbolDeclaration}) {
+      checkValues(column + LocationPath, numSymbols, (uint32_t)numStrings,
+                  true);
+      for (int i = LocationStartLine; i <= LocationEndColumn; i++) {
+        checkSize(column + i, numSymbols);
+      }
+    }
+    for (int column = SymbolNumbersSet; column <= SymbolFlags; column++) {
+      checkSize(column, numSymbols);
+    }
+    checkValues(SymbolsByName, numSymbols, (uint32_t)numSymbols, false);
+    checkValues(SymbolsByScope, numSymbols, (uint32_t)numSymbols, false);
+
+    auto numRefs = ColumnSize<uint32_t>(RefKind);
+    checkOffsets(RefOffsets, numSymbols, numRefs);
+    checkValues(RefLocation + LocationPath, numRefs, (uint32_t)numStrings,
+                false);
+    for (int i = LocationStartLine; i <= LocationEndColumn; i++) {
+      checkSize(RefLocation + i, numRefs);
+    }
+
+    for (int kind = 0; kind < num_relation_kinds; kind++) {
+      auto numObjects = ColumnSize<uint32_t>(RelationObjects + 2 * kind);
+      checkOffsets(RelationOffsets + 2 * kind, numSymbols, numObjects);
+      checkValues(RelationObjects + 2 * kind, numObjects,
+                  (uint32_t)numSymbols, false);
+    }
+  }
+
+  const char *Text(uint32_t index) const {
+    return Column<char>(StringData) + Column<uint64_t>(StringOffsets)[index];
+  }
+
+  size_t TextSize(uint32_t index) const {
+    auto offsets = Column<uint64_t>(StringOffsets);
+    return offsets[index + 1] - offsets[index];
+  }
+
+  int Compare(uint32_t index, const std::string &string) const {
+    auto size = TextSize(index);
+    int res = std::memcmp(Text(index), string.data(),
+                          std::min(size, string.size()));
+    return res ? res : size < string.size() ? -1 : size > string.size();
+  }
+
+  // Finds `string` in the dictionary
+  bool FindString(const std::string &string, uint32_t &index) const {
+    uint32_t low = 0, high = (uint32_t)numStrings;
+    while (low < high) {
+      auto mid = low + (high - low) / 2;
+      if (Compare(mid, string) < 0) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    index = low;
+    return low < numStrings && Compare(low, string) == 0;
+  }
+
+  // Finds the row of the symbol whose id is `id`
+  bool FindSymbol(const std::string &id, uint32_t &row) const {
+    uint32_t index;
+    if (!FindString(id, index)) {
+      return false;
+    }
+    auto ids = Column<uint32_t>(SymbolId);
+    auto it = std::lower_bound(ids, ids + numSymbols, index);
+    row = (uint32_t)(it - ids);
+    return it != ids + numSymbols && *it == index;
+  }
+
+  // Rows of the `count` symbols whose column `column` is `index`, in the
+  // order `order`, which must be sorted by that column
+  const uint32_t *EqualRange(int order, int column, uint32_t index,
+                             size_t &count) const {
+    auto rows = Column<uint32_t>(order);
+    auto values = Column<uint32_t>(column);
+    auto first =
+     std::partition_point(rows, rows + numSymbols,
+                          [&](uint32_t row) { return values[row] < index; });
+    auto last = std::partition_point(
+     first, rows + numSymbols,
+     [&](uint32_t row) { return values[row] == index; });
+    count = (size_t)(last - first);
+    return first;
+  }
+
+  void ReadString(int column, uint32_t row, std::string *dest) const {
+    auto index = Column<uint32_t>(column)[row];
+    dest->assign(Text(index), TextSize(index));
+  }
+
+  uint32_t Number(int column, uint32_t row) const {
+    return Column<uint32_t>(column)[row];
+  }
+
+  void ReadLocation(int column, uint32_t row, SymbolLocation &dest) const {
+    ReadString(column + LocationPath, row, dest.mutable_file_path());
+    dest.mutable_start()->set_line(Number(column + LocationStartLine, row));
+    dest.mutable_start()->set_column(Number(column + LocationStartColumn, row));
+    dest.mutable_end()->set_line(Number(column + LocationEndLine, row));
+    dest.mutable_end()->set_column(Number(column + LocationEndColumn, row));
+  }
+
+  void Read(uint64_t row, Symbol &dest) const {
+    auto r = (uint32_t)row;
+    ReadString(SymbolId, r, dest.mutable_id());
+    for (auto &field : text_fields) {
+      if (Number(field.column, r) != no_string) {
+        ReadString(field.column, r, (dest.*field.mutate)());
+      }
+    }
+    auto set = Number(SymbolNumbersSet, r);
+    if (set & 1 << DefinitionSet) {
+      ReadLocation(SymbolDefinition, r, *dest.mutable_definition());
+    }
+    if (set & 1 << DeclarationSet) {
+      ReadLocation(SymbolDeclaration, r, *dest.mutable_canonical_declaration());
+    }
+    if (set & 1 << InfoSet) {
+      auto info = dest.mutable_info();
+      if (set & 1 << KindSet) {
+        info->set_kind(Number(SymbolKind, r));
+      }
+      if (set & 1 << SubKindSet) {
+        info->set_subkind(Number(SymbolSubKind, r));
+      }
+      if (set & 1 << LanguageSet) {
+        info->set_language(Number(SymbolLanguage, r));
+      }
+      if (set & 1 << PropertiesSet) {
+        info->set_properties(Number(SymbolProperties, r));
+      }
+    }
+    if (set & 1 << ReferencesSet) {
+      dest.set_references((int32_t)Number(SymbolReferences, r));
+    }
+    if (set & 1 << OriginSet) {
+      dest.set_origin(Number(SymbolOrigin, r));
+    }
+    if (set & 1 << FlagsSet) {
+      dest.set_flags(Number(SymbolFlags, r));
+    }
+  }
+
+  void Read(uint64_t ref, Ref &dest) const {
+    dest.set_kind(Number(RefKind, (uint32_t)ref));
+    ReadLocation(RefLocation, (uint32_t)ref, *dest.mutable_location());
+  }
+
+  // Relations are numbered by the row of their subject and the row of their
+  // object
+  void Read(uint64_t relation, Relation &dest) const {
+    ReadString(SymbolId, (uint32_t)(relation >> 32), dest.mutable_subject_id());
+    Read(relation & UINT32_MAX, *dest.mutable_object());
+  }
+};
+
+// Results read from a snapshot, which are all known when the stream is
+// created but only decoded as they are read
+template <typename T> class SnapshotStream final : public IResultStream<T> {
+  const SnapshotFile &m_file;
+  std::vector<uint64_t> m_items;
+  size_t m_next = 0;
+  bool m_hasMore;
+  bool m_ok = true;
+  bool m_done = false;
+  CallRecorder m_recorder;
+  T m_current;
+
+public:
+  SnapshotStream(const SnapshotFile &file, std::vector<uint64_t> items,
+                 bool hasMore, RpcCounters &counters)
+    : m_file(file), m_items(std::move(items)), m_hasMore(hasMore),
+      m_recorder(counters) {}
+
+  ~SnapshotStream() override {
+    m_recorder.Finish(m_ok && m_done, m_ok && !m_done);
+  }
+
+  // Makes the call count as failed, as a server would for an invalid request
+  void Fail() {
+    m_ok = false;
+    m_items.clear();
+  }
+
+  const T &Current() override { return m_current; }
+
+  bool Next() override {
+    if (m_next == m_items.size()) {
+      if (m_ok && !m_done) {
+        m_done = true;
+        m_recorder.Done();
+      }
+      return false;
+    }
+    m_current.Clear();
+    m_file.Read(m_items[m_next++], m_current);
+    m_recorder.Message(0);
+    return true;
+  }
+
+  bool HasMore() override { return m_hasMore; }
+
+  bool Ok() override { return m_ok; }
+
+  void MoveCurrent(T &dest) override { dest.Swap(&m_current); }
+};
+
+// Collects results up to the limit of a request, remembering whether some
+// were left out
+class ResultCollector {
+  uint32_t m_limit;
+
+public:
+  std::vector<uint64_t> items;
+  bool hasMore = false;
+
+  // A limit of 0 means no limit, as for clangd
+  explicit ResultCollector(uint32_t limit) : m_limit(limit) {}
+
+  // Returns false if no more results should be added
+  bool Add(uint64_t item) {
+    if (m_limit && items.size() == m_limit) {
+      hasMore = true;
+      return false;
+    }
+    items.push_back(item);
+    return true;
+  }
+};
+
+SnapshotBackend::SnapshotBackend(const std::string &path)
+  : m_file(std::make_unique<SnapshotFile>(path)) {}
+
+SnapshotBackend::~SnapshotBackend() = default;
+
+std::unique_ptr<IResultStream<Symbol>>
+SnapshotBackend::Lookup(const LookupRequest &req, RpcCounters &counters) {
+  ResultCollector results(0);
+  uint32_t row;
+  for (auto &id : req.ids()) {
+    if (m_file->FindSymbol(id, row)) {
+      results.Add(row);
+    }
+  }
+  return std::make_unique<SnapshotStream<Symbol>>(
+   *m_file, std::move(results.items), false, counters);
+}
+
+std::unique_ptr<IResultStream<Symbol>>
+SnapshotBackend::FuzzyFind(const FuzzyFindRequest &req,
+                           RpcCounters &counters) {
+  ResultCollector results(req.limit());
+  auto &query = req.query();
+  auto names = m_file->Column<uint32_t>(SymbolName);
+  auto matches = [&](uint32_t row) {
+    return query.empty() ||
+           (names[row] != no_string &&
+            fuzzy_matches(query, m_file->Text(names[row]),
+                          m_file->TextSize(names[row])));
+  };
+
+  // Listed scopes only restrict the results if any_scope is not set
+  if (!req.any_scope() && req.scopes_size() > 0) {
+    for (auto &scope : req.scopes()) {
+      uint32_t index;
+      if (!m_file->FindString(scope, index)) {
+        continue;
+      }
+      size_t count;
+      auto rows = m_file->EqualRange(SymbolsByScope, SymbolScope, index, count);
+      for (size_t i = 0; i < count; i++) {
+        if (matches(rows[i]) && !results.Add(rows[i])) {
+          break;
+        }
+      }
+    }
+  } else {
+    // Symbols are ordered by name, so each name is only matched once
+    auto rows = m_file->Column<uint32_t>(SymbolsByName);
+    uint32_t lastName = no_string;
+    bool lastMatched = false;
+    for (size_t i = 0; i < m_file->numSymbols; i++) {
+      auto row = rows[i];
+      if (i == 0 || names[row] != lastName) {
+        lastName = names[row];
+        lastMatched = matches(row);
+      }
+      if (lastMatched && !results.Add(row)) {
+        break;
+      }
+    }
+  }
+  return std::make_unique<SnapshotStream<Symbol>>(
+   *m_file, std::move(results.items), results.hasMore, counters);
+}
+
+std::unique_ptr<IResultStream<Ref>>
+SnapshotBackend::Refs(const RefsRequest &req, RpcCounters &counters) {
+  ResultCollector results(req.limit());
+  auto offsets = m_file->Column<uint64_t>(RefOffsets);
+  auto kinds = m_file->Column<uint32_t>(RefKind);
+  auto filter = req.has_filter() ? req.filter() : UINT32_MAX;
+  uint32_t row;
+  for (auto &id : req.ids()) {
+    if (!m_file->FindSymbol(id, row)) {
+      continue;
+    }
+    for (auto ref = offsets[row]; ref < offsets[row + 1]; ref++) {
+      // As in clangd, a filter of 0 matches nothing
+      if ((kinds[ref] & filter) && !results.Add(ref)) {
+        break;
+      }
+    }
+  }
+  return std::make_unique<SnapshotStream<Ref>>(
+   *m_file, std::move(results.items), results.hasMore, counters);
+}
+
+std::unique_ptr<IResultStream<Relation>>
+SnapshotBackend::Relations(const RelationsRequest &req,
+                           RpcCounters &counters) {
+  ResultCollector results(req.limit());
+  if (req.predicate() >= num_relation_kinds) {
+    auto stream = std::make_unique<SnapshotStream<Relation>>(
+     *m_file, std::vector<uint64_t>(), false, counters);
+    stream->Fail();
+    return stream;
+  }
+
+  auto offsets = m_file->Column<uint64_t>(RelationOffsets +
+                                          2 * (int)req.predicate());
+  auto objects = m_file->Column<uint32_t>(RelationObjects +
+                                          2 * (int)req.predicate());
+  uint32_t row;
+  for (auto &subject : req.subjects()) {
+    if (!m_file->FindSymbol(subject, row)) {
+      continue;
+    }
+    for (auto i = offsets[row]; i < offsets[row + 1]; i++) {
+      if (!results.Add((uint64_t)row << 32 | objects[i])) {
+        break;
+      }
+    }
+  }
+  return std::make_unique<SnapshotStream<Relation>>(
+   *m_file, std::move(results.items), results.hasMore, counters);
+}
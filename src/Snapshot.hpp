@@ -0,0 +1,58 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+#include "IndexBackend.hpp"
+#include "Statistics.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// A snapshot is a copy of a whole index in a single file, which the
+// `snapshot:PATH` connection string serves without any server.
+//
+// Snapshots are columnar: each field of the symbols, references and relations
+// is an array of fixed-size values, and every string is stored once, in a
+// sorted dictionary that the columns refer to by index. The file is mapped in
+// memory as it is, and is only read from when queried.
+
+// Crawls the index served by `backend` with `threads` calls at a time, and
+// writes everything it found as a snapshot at `path`. Returns the number of
+// symbols written. The calls are accounted for in `stats`. Throws
+// std::runtime_error if any call fails or the file can't be written.
+//
+// The protocol has no way of listing every symbol, so symbols are searched
+// for scope by scope, starting from the scopes of the symbols found by
+// searches in any scope. Scopes with more symbols than a single call returns
+// are split by the first letters of the names. Symbols are only found if
+// their scope is, or another symbol shares their scope.
+size_t WriteSnapshot(IndexBackend &backend, TableStats &stats,
+                     const std::string &path, size_t threads);
+
+class SnapshotFile;
+
+// Backend answering from a snapshot. Names are matched as a subsequence,
+// ignoring case, and results come in the order of their names or scopes
+// rather than ranked as clangd would.
+class SnapshotBackend final : public IndexBackend {
+  std::unique_ptr<SnapshotFile> m_file;
+
+public:
+  // Throws std::runtime_error if `path` is not a valid snapshot
+  explicit SnapshotBackend(const std::string &path);
+  ~SnapshotBackend() override;
+
+  std::unique_ptr<IResultStream<clang::clangd::remote::Symbol>>
+  Lookup(const clang::clangd::remote::LookupRequest &req,
+         RpcCounters &counters) override;
+  std::unique_ptr<IResultStream<clang::clangd::remote::Symbol>>
+  FuzzyFind(const clang::clangd::remote::FuzzyFindRequest &req,
+            RpcCounters &counters) override;
+  std::unique_ptr<IResultStream<clang::clangd::remote::Ref>>
+  Refs(const clang::clangd::remote::RefsRequest &req,
+       RpcCounters &counters) override;
+  std::unique_ptr<IResultStream<clang::clangd::remote::Relation>>
+  Relations(const clang::clangd::remote::RelationsRequest &req,
+            RpcCounters &counters) override;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "Statistics.hpp"
+
+#include <mutex>
+#include <vector>
+
+const char *RpcName(RpcKind kind) {
+  switch (kind) {
+  case RpcKind::Lookup:
+    return "Lookup";
+  case RpcKind::FuzzyFind:
+    return "FuzzyFind";
+  case RpcKind::Refs:
+    return "Refs";
+  case RpcKind::Relations:
+    return "Relations";
+  }
+  return "Unknown";
+}
+
+// Values below this get a bucket of their own
+constexpr uint64_t exact_buckets = 8;
+
+int LatencyHistogram::Bucket(uint64_t micros) {
+  if (micros < exact_buckets) {
+    return (int)micros;
+  }
+
+  int log = 63;
+  while (!(micros >> log)) {
+    log--;
+  }
+  // The two bits after the leading one select the quarter
+  int quarter = (int)((micros >> (log - 2)) & 3);
+  int bucket = (int)exact_buckets + (log - 3) * 4 + quarter;
+  return bucket < num_buckets ? bucket : num_buckets - 1;
+}
+
+uint64_t LatencyHistogram::Quantile(double q) const {
+  uint64_t counts[num_buckets];
+  uint64_t total = 0;
+  for (int i = 0; i < num_buckets; i++) {
+    counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+
+  auto rank = (uint64_t)(q * (double)(total - 1)) + 1;
+  uint64_t seen = 0;
+  int i = 0;
+  for (; i < num_buckets - 1; i++) {
+    seen += counts[i];
+    if (seen >= rank) {
+      break;
+    }
+  }
+
+  if (i < (int)exact_buckets) {
+    return (uint64_t)i;
+  }
+  int log = (i - (int)exact_buckets) / 4 + 3;
+  uint64_t quarter = (uint64_t)((i - (int)exact_buckets) % 4);
+  return ((5 + quarter) << (log - 2)) - 1;
+}
+
+static std::mutex tables_mutex;
+static std::vector<std::shared_ptr<TableStats>> tables;
+
+std::shared_ptr<TableStats> GetTableStats(const std::string &table,
+                                          const std::string &server) {
+  std::lock_guard<std::mutex> lock(tables_mutex);
+  for (auto &stats : tables) {
+    if (stats->table == table && stats->server == server) {
+      return stats;
+    }
+  }
+
+  auto stats = std::make_shared<TableStats>();
+  stats->table = table;
+  stats->server = server;
+  for (int i = 0; i < num_rpc_kinds; i++) {
+    stats->rpcs[i].kind = (RpcKind)i;
+    stats->rpcs[i].table = &stats->table;
+  }
+  tables.push_back(stats);
+  return stats;
+}
+
+void ForEachTableStats(const std::function<void(TableStats &)> &fn) {
+  std::vector<std::shared_ptr<TableStats>> snapshot;
+  {
+    std::lock_guard<std::mutex> lock(tables_mutex);
+    snapshot = tables;
+  }
+  for (auto &stats : snapshot) {
+    fn(*stats);
+  }
+}
@@ -0,0 +1,155 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+#include "Trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+enum class RpcKind { Lookup, FuzzyFind, Refs, Relations };
+
+constexpr int num_rpc_kinds = 4;
+
+const char *RpcName(RpcKind kind);
+
+// Distribution of durations in microseconds, which can be recorded from any
+// thread without locking. Values are counted in buckets a quarter of a power
+// of two wide, so quantiles are accurate to within 25%.
+class LatencyHistogram {
+public:
+  // Enough buckets for durations of several hours
+  static constexpr int num_buckets = 136;
+
+  void Record(uint64_t micros) {
+    m_buckets[Bucket(micros)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Returns the upper bound of the bucket holding the `q` quantile, or 0 if
+  // nothing was recorded
+  uint64_t Quantile(double q) const;
+
+private:
+  std::atomic<uint64_t> m_buckets[num_buckets]{};
+
+  static int Bucket(uint64_t micros);
+};
+
+// Counters for a single kind of RPC issued on behalf of a table
+struct RpcCounters {
+  // What the calls are, to label them in traces
+  RpcKind kind = RpcKind::Lookup;
+  const std::string *table = nullptr;
+
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> messages{0};
+  std::atomic<uint64_t> bytes{0};
+  // Calls that ended with an error other than being cancelled, or whose
+  // replies could not be understood
+  std::atomic<uint64_t> errors{0};
+  // Calls that were cancelled before the server was done sending results
+  std::atomic<uint64_t> cancelled{0};
+  // Replies that were received but never looked at, because the stream had
+  // been cancelled
+  std::atomic<uint64_t> discardedMessages{0};
+  std::atomic<uint64_t> discardedBytes{0};
+  // Calls of this kind that were avoided by a cache, or had to be made
+  std::atomic<uint64_t> cacheHits{0};
+  std::atomic<uint64_t> cacheMisses{0};
+  // Time from the start of a call to the end of its results, for calls that
+  // were read to the end
+  LatencyHistogram latency;
+  // Time from the start of a call to its first reply
+  LatencyHistogram firstMessage;
+};
+
+// The counters of a table, which are kept for as long as the process runs so
+// that reconnecting to the table adds to the same counters
+struct TableStats {
+  std::string table;
+  std::string server;
+  RpcCounters rpcs[num_rpc_kinds];
+
+  RpcCounters &Rpc(RpcKind kind) { return rpcs[(int)kind]; }
+};
+
+// Returns the counters of the table named `table` reading from `server`
+std::shared_ptr<TableStats> GetTableStats(const std::string &table,
+                                          const std::string &server);
+
+// Calls `fn` with the counters of every table, in the order they were created
+void ForEachTableStats(const std::function<void(TableStats &)> &fn);
+
+// Accounts for a single call in the counters of its RPC
+class CallRecorder {
+  RpcCounters &m_counters;
+  std::chrono::steady_clock::time_point m_start;
+  bool m_gotMessage = false;
+  // Identifies the call in the trace, or 0 if it is not traced
+  uint64_t m_traceId = 0;
+  uint64_t m_messages = 0;
+  uint64_t m_bytes = 0;
+  // Microseconds until the server was done, or -1 if it is not done yet
+  int64_t m_latency = -1;
+
+  uint64_t Elapsed() const {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - m_start)
+     .count();
+  }
+
+public:
+  explicit CallRecorder(RpcCounters &counters)
+    : m_counters(counters), m_start(std::chrono::steady_clock::now()) {
+    m_counters.calls.fetch_add(1, std::memory_order_relaxed);
+    if (TraceEnabled()) {
+      m_traceId = NewTraceId();
+      TraceAsync('b', "rpc", RpcName(m_counters.kind), m_traceId,
+                 m_counters.table ? TraceArg("table", *m_counters.table)
+                                  : std::string());
+    }
+  }
+
+  RpcCounters &Counters() { return m_counters; }
+
+  void Message(size_t bytes) {
+    if (!m_gotMessage) {
+      m_gotMessage = true;
+      m_counters.firstMessage.Record(Elapsed());
+      if (m_traceId) {
+        TraceAsync('n', "rpc", "first message", m_traceId);
+      }
+    }
+    m_messages++;
+    m_bytes += bytes;
+    m_counters.messages.fetch_add(1, std::memory_order_relaxed);
+    m_counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  // The server is done sending results
+  void Done() { m_latency = (int64_t)Elapsed(); }
+
+  void Error() { m_counters.errors.fetch_add(1, std::memory_order_relaxed); }
+
+  // The call is over. Only the latency of calls that succeeded is recorded.
+  // Cancelled calls are neither errors nor successes.
+  void Finish(bool ok, bool cancelled) {
+    if (ok && m_latency >= 0) {
+      m_counters.latency.Record((uint64_t)m_latency);
+    } else if (!ok && !cancelled) {
+      Error();
+    }
+
+    if (m_traceId) {
+      const char *status = ok ? "ok" : cancelled ? "cancelled" : "error";
+      TraceAsync('e', "rpc", RpcName(m_counters.kind), m_traceId,
+                 TraceArg("status", status) + "," +
+                  TraceArg("messages", (int64_t)m_messages) + "," +
+                  TraceArg("bytes", (int64_t)m_bytes));
+    }
+  }
+};
+
+#endif
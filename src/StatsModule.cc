@@ -0,0 +1,120 @@
+#include "StatsModule.hpp"
+#include "Statistics.hpp"
+#include "sqlite3ext.h"
+SQLITE_EXTENSION_INIT3
+#include "VirtualTable.hpp"
+#include "VirtualTableCursor.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+constexpr const char *schema = R"cpp(
+  CREATE TABLE vtable(TableName TEXT, Server TEXT, Rpc TEXT,
+    Calls INT, Messages INT, Bytes INT, Errors INT, Cancelled INT,
+    DiscardedMessages INT, DiscardedBytes INT, CacheHits INT, CacheMisses INT,
+    LatencyP50 INT, LatencyP95 INT, LatencyP99 INT,
+    FirstMessageP50 INT, FirstMessageP95 INT, FirstMessageP99 INT)
+  )cpp";
+
+// Columns after the names
+constexpr int num_values = 15;
+
+struct StatsRow {
+  std::string table;
+  std::string server;
+  RpcKind rpc;
+  uint64_t values[num_values];
+};
+
+static bool is_unused(const RpcCounters &counters) {
+  return counters.calls == 0 && counters.cacheHits == 0 &&
+         counters.cacheMisses == 0;
+}
+
+static StatsRow make_row(const TableStats &stats, RpcKind rpc,
+                         const RpcCounters &counters) {
+  return {stats.table,
+          stats.server,
+          rpc,
+          {counters.calls, counters.messages, counters.bytes, counters.errors,
+           counters.cancelled, counters.discardedMessages,
+           counters.discardedBytes, counters.cacheHits, counters.cacheMisses,
+           counters.latency.Quantile(0.5), counters.latency.Quantile(0.95),
+           counters.latency.Quantile(0.99),
+           counters.firstMessage.Quantile(0.5),
+           counters.firstMessage.Quantile(0.95),
+           counters.firstMessage.Quantile(0.99)}};
+}
+
+class StatsCursor final : public VirtualTableCursor {
+  // The counters are copied when the scan starts, so that rows are
+  // consistent with each other while they are read
+  std::vector<StatsRow> m_rows;
+  size_t m_row = 0;
+
+public:
+  int Filter(int idxNum, const char *idxStr, int argc,
+             sqlite3_value **argv) override {
+    m_rows.clear();
+    m_row = 0;
+    ForEachTableStats([&](TableStats &stats) {
+      for (int i = 0; i < num_rpc_kinds; i++) {
+        auto &counters = stats.Rpc((RpcKind)i);
+        if (!is_unused(counters)) {
+          m_rows.push_back(make_row(stats, (RpcKind)i, counters));
+        }
+      }
+    });
+    return SQLITE_OK;
+  }
+  int Next() override {
+    m_row++;
+    return SQLITE_OK;
+  }
+  int Eof() override { return m_row >= m_rows.size(); }
+  int Column(sqlite3_context *ctx, int idxCol) override {
+    auto &row = m_rows[m_row];
+    switch (idxCol) {
+    case 0:
+      ResultText(ctx, row.table);
+      break;
+    case 1:
+      ResultText(ctx, row.server);
+      break;
+    case 2:
+      sqlite3_result_text(ctx, RpcName(row.rpc), -1, nullptr);
+      break;
+    default:
+      sqlite3_result_int64(ctx, (sqlite3_int64)row.values[idxCol - 3]);
+      break;
+    }
+    return SQLITE_OK;
+  }
+  sqlite3_int64 RowId() override { return m_row; }
+};
+
+class StatsTable final : public VirtualTable {
+public:
+  StatsTable(sqlite3 *db) {
+    if (sqlite3_declare_vtab(db, schema) != SQLITE_OK) {
+      throw std::runtime_error(sqlite3_errmsg(db));
+    }
+  }
+
+  int BestIndex(sqlite3_index_info *info) override {
+    // There are only a handful of rows, which are all in memory
+    info->estimatedCost = 10;
+    return SQLITE_OK;
+  }
+
+  std::unique_ptr<VirtualTableCursor> Open() override {
+    return std::make_unique<StatsCursor>();
+  }
+};
+
+std::unique_ptr<VirtualTable> StatsModule::Create(sqlite3 *db, int argc,
+                                                  const char *const *argv) {
+  return std::make_unique<StatsTable>(db);
+}
@@ -0,0 +1,16 @@
+#ifndef STATSMODULE_HPP
+#define STATSMODULE_HPP
+#include "Module.hpp"
+
+// Module of the `clangql_stats` table, which reports the counters kept for
+// every RPC made on behalf of each table. It needs no arguments, so it can be
+// queried without creating it first:
+//
+//   SELECT * FROM clangql_stats
+class StatsModule final : public Module {
+public:
+  std::unique_ptr<VirtualTable> Create(sqlite3 *db, int argc,
+                                       const char *const *argv) override;
+};
+
+#endif
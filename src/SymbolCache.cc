@@ -0,0 +1,109 @@
+#include "SymbolCache.hpp"
+#include "SymbolId.hpp"
+
+using namespace clang::clangd::remote;
+
+SymbolCache::SymbolCache(size_t capacity) : m_capacity(capacity) {}
+
+SymbolCache::SymbolPtr SymbolCache::Find(const std::string &id) {
+  uint64_t key;
+  if (!ParseSymbolId(id, key)) {
+    return nullptr;
+  }
+  return Find(key);
+}
+
+SymbolCache::SymbolPtr SymbolCache::Find(uint64_t id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_index.find(id);
+  if (it == m_index.end()) {
+    return nullptr;
+  }
+
+  // Move the entry to the front, so it is the last one to be evicted
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  return it->second->second;
+}
+
+void SymbolCache::Insert(const Symbol &symbol) {
+  if (!symbol.has_id() || m_capacity == 0) {
+    return;
+  }
+
+  Insert(std::make_shared<const Symbol>(symbol));
+}
+
+void SymbolCache::Insert(SymbolPtr symbol) {
+  uint64_t id;
+  if (m_capacity == 0 || !ParseSymbolId(symbol->id(), id)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_index.find(id);
+  if (it != m_index.end()) {
+    it->second->second = std::move(symbol);
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return;
+  }
+
+  m_entries.emplace_front(id, std::move(symbol));
+  m_index[id] = m_entries.begin();
+
+  if (m_entries.size() > m_capacity) {
+    m_index.erase(m_entries.back().first);
+    m_entries.pop_back();
+  }
+}
+
+bool SymbolCache::FindByName(const std::string &name,
+                             std::vector<SymbolPtr> &symbols) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_names.find(name);
+  if (it == m_names.end()) {
+    return false;
+  }
+
+  std::vector<SymbolPtr> res;
+  for (auto &id : it->second) {
+    auto entry = m_index.find(id);
+    if (entry == m_index.end()) {
+      // Some of the symbols were evicted since
+      m_names.erase(it);
+      return false;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, entry->second);
+    res.push_back(entry->second->second);
+  }
+
+  symbols = std::move(res);
+  return true;
+}
+
+void SymbolCache::InsertName(const std::string &name,
+                             std::vector<std::string> ids) {
+  if (m_capacity == 0) {
+    return;
+  }
+
+  std::vector<uint64_t> keys;
+  keys.reserve(ids.size());
+  for (auto &id : ids) {
+    uint64_t key;
+    if (!ParseSymbolId(id, key)) {
+      // Such a symbol could not be found in the cache anyway
+      return;
+    }
+    keys.push_back(key);
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_names.size() >= m_capacity && !m_names.count(name)) {
+    m_names.erase(m_names.begin());
+  }
+  m_names[name] = std::move(keys);
+}
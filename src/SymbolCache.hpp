@@ -0,0 +1,85 @@
+#ifndef SYMBOLCACHE_HPP
+#define SYMBOLCACHE_HPP
+#include "IResultStream.hpp"
+#include "Index.pb.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Least-recently-used cache of `Symbol` messages, keyed by SymbolID. A single
+// instance is shared by every table connected to the same server, so symbols
+// that already came over the wire don't need another `Lookup` round trip.
+//
+// Ids are stored in their 64-bit binary form. Symbols whose id is not valid
+// hex are never cached.
+class SymbolCache {
+public:
+  using SymbolPtr = std::shared_ptr<const clang::clangd::remote::Symbol>;
+
+  explicit SymbolCache(size_t capacity);
+
+  SymbolPtr Find(const std::string &id);
+  SymbolPtr Find(uint64_t id);
+  void Insert(const clang::clangd::remote::Symbol &symbol);
+  // Stores `symbol` without copying it
+  void Insert(SymbolPtr symbol);
+
+  // Stores in `symbols` every symbol named `name`, if they are all known and
+  // still cached
+  bool FindByName(const std::string &name, std::vector<SymbolPtr> &symbols);
+  // Records that `ids` are the ids of every symbol named `name`, as found by
+  // a search that was not limited in any way
+  void InsertName(const std::string &name, std::vector<std::string> ids);
+
+private:
+  using Entry = std::pair<uint64_t, SymbolPtr>;
+
+  std::mutex m_mutex;
+  size_t m_capacity;
+  std::list<Entry> m_entries;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> m_index;
+  // Ids of the symbols with a given name, at most `m_capacity` names
+  std::unordered_map<std::string, std::vector<uint64_t>> m_names;
+};
+
+// Serves symbols that were found in the cache
+class CachedSymbolStream final
+  : public IResultStream<clang::clangd::remote::Symbol> {
+  std::vector<SymbolCache::SymbolPtr> m_symbols;
+  size_t m_next = 0;
+
+public:
+  CachedSymbolStream() = default;
+  CachedSymbolStream(std::vector<SymbolCache::SymbolPtr> symbols)
+    : m_symbols(std::move(symbols)) {}
+
+  // Starts over with no symbols, keeping the storage of the previous ones
+  void Reset() {
+    m_symbols.clear();
+    m_next = 0;
+  }
+  void Add(SymbolCache::SymbolPtr symbol) {
+    m_symbols.push_back(std::move(symbol));
+  }
+  bool Empty() const { return m_symbols.empty(); }
+
+  const clang::clangd::remote::Symbol &Current() override {
+    return *m_symbols[m_next - 1];
+  }
+
+  bool Next() override { return m_next++ < m_symbols.size(); }
+
+  std::shared_ptr<const clang::clangd::remote::Symbol>
+  ShareCurrent() override {
+    return m_symbols[m_next - 1];
+  }
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "SymbolId.hpp"
+
+#include <cstring>
+
+// Hex digits are converted 8 at a time, one per byte of a 64-bit word
+// (SIMD within a register), which needs the first digit in the lowest byte
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ ||    \
+ defined(_M_X64) || defined(_M_IX86) || defined(_M_ARM64)
+#define SYMBOLID_SWAR 1
+#endif
+
+constexpr uint64_t ones = 0x0101010101010101ULL;
+constexpr uint64_t high_bits = 0x8080808080808080ULL;
+
+#ifdef SYMBOLID_SWAR
+// High bit of each byte of `x` that is at least `n`, for bytes below 0x80
+static uint64_t bytes_ge(uint64_t x, uint8_t n) {
+  return (x + (0x80 - n) * ones) & high_bits;
+}
+
+// High bit of each byte of `x` that is at most `n`, for bytes below 0x80
+static uint64_t bytes_le(uint64_t x, uint8_t n) {
+  return ~(x + (0x7F - n) * ones) & high_bits;
+}
+
+// Parses the 8 hex digits in `chars`
+static bool parse_word(const char *chars, uint32_t &res) {
+  uint64_t x;
+  std::memcpy(&x, chars, sizeof(x));
+  if (x & high_bits) {
+    return false;
+  }
+
+  auto digit = bytes_ge(x, '0') & bytes_le(x, '9');
+  auto lower = x | 0x20 * ones;
+  auto letter = bytes_ge(lower, 'a') & bytes_le(lower, 'f');
+  if ((digit | letter) != high_bits) {
+    return false;
+  }
+
+  // '0'-'9' and 'a'-'f' both end with their value, letters are off by 9
+  auto nibbles = (x & 0x0F * ones) + (letter >> 7) * 9;
+  // Pairs of digits into bytes, in the low byte of each 16-bit lane
+  auto bytes = ((nibbles << 4) | (nibbles >> 8)) & 0x00FF00FF00FF00FFULL;
+  res = (uint32_t)(bytes & 0xFF) << 24 | (uint32_t)(bytes >> 16 & 0xFF) << 16 |
+        (uint32_t)(bytes >> 32 & 0xFF) << 8 | (uint32_t)(bytes >> 48 & 0xFF);
+  return true;
+}
+
+// Writes `value` as 8 uppercase hex digits to `chars`
+static void format_word(uint32_t value, char *chars) {
+  // Spread the nibbles to one byte each, the least significant one first
+  uint64_t x = value;
+  x = (x | x << 16) & 0x0000FFFF0000FFFFULL;
+  x = (x | x << 8) & 0x00FF00FF00FF00FFULL;
+  x = (x | x << 4) & 0x0F0F0F0F0F0F0F0FULL;
+#if defined(_MSC_VER)
+  x = _byteswap_uint64(x);
+#else
+  x = __builtin_bswap64(x);
+#endif
+
+  // Nibbles of 10 and more become letters
+  auto letters = ((x + 0x06 * ones) & 0x10 * ones) >> 4;
+  x += '0' * ones + letters * ('A' - '0' - 10);
+  std::memcpy(chars, &x, sizeof(x));
+}
+#else
+static bool parse_word(const char *chars, uint32_t &res) {
+  res = 0;
+  for (int i = 0; i < 8; i++) {
+    auto c = chars[i];
+    uint32_t nibble;
+    if (c >= '0' && c <= '9') {
+      nibble = c - '0';
+    } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+      nibble = (c | 0x20) - 'a' + 10;
+    } else {
+      return false;
+    }
+    res = res << 4 | nibble;
+  }
+  return true;
+}
+
+static void format_word(uint32_t value, char *chars) {
+  for (int i = 7; i >= 0; i--) {
+    chars[i] = "0123456789ABCDEF"[value & 0xF];
+    value >>= 4;
+  }
+}
+#endif
+
+bool ParseSymbolId(const std::string &hex, uint64_t &id) {
+  uint32_t hi, lo;
+  if (hex.size() != 16 || !parse_word(hex.data(), hi) ||
+      !parse_word(hex.data() + 8, lo)) {
+    return false;
+  }
+  id = (uint64_t)hi << 32 | lo;
+  return true;
+}
+
+std::string FormatSymbolId(uint64_t id) {
+  std::string hex(16, '\0');
+  format_word((uint32_t)(id >> 32), &hex[0]);
+  format_word((uint32_t)id, &hex[8]);
+  return hex;
+}
@@ -0,0 +1,16 @@
+#ifndef SYMBOLID_HPP
+#define SYMBOLID_HPP
+#include <cstdint>
+#include <string>
+
+// SymbolIDs are 8 bytes, sent over the wire as 16 uppercase hex digits. As
+// integers they are read big-endian, so they sort like their hex form.
+
+// Stores in `id` the SymbolID written in hex in `hex`, returning false if it
+// is not made of exactly 16 hex digits
+bool ParseSymbolId(const std::string &hex, uint64_t &id);
+
+// Returns the hex form of `id`, as sent by the server
+std::string FormatSymbolId(uint64_t id);
+
+#endif
@@ -1,61 +1,280 @@
 #include "SymbolsTable.hpp"
+#include "CostModel.hpp"
 #include "IResultStream.hpp"
+#include "PagedStream.hpp"
+#include "PrefetchStream.hpp"
+#include "SymbolId.hpp"
 SQLITE_EXTENSION_INIT3
 #include "VirtualTableCursor.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 using namespace clang::clangd::remote;
-using clang::clangd::remote::v1::SymbolIndex;
 
-class FuzzyFindStream final : public IResultStream<Symbol> {
-  grpc::ClientContext m_ctx;
-  std::unique_ptr<grpc::ClientReader<FuzzyFindReply>> m_replyReader;
-  FuzzyFindReply m_reply;
+// Columns from `first` to `last`, in the format of colUsed
+static sqlite3_uint64 columns(int first, int last) {
+  sqlite3_uint64 mask = 0;
+  for (int column = first; column <= last; column++) {
+    mask |= 1ULL << (column < 63 ? column : 63);
+  }
+  return mask;
+}
+
+// Copies the fields of `symbol` backing the columns in `columnsUsed` to
+// `dest`, along with the id, name and scope that are needed to identify it.
+// Wide fields such as the documentation are left alone unless selected.
+static void copy_used_fields(const Symbol &symbol, Symbol &dest,
+                             sqlite3_uint64 columnsUsed) {
+  if (columnsUsed == ~0ULL) {
+    dest = symbol;
+    return;
+  }
+
+  dest.Clear();
+  if (symbol.has_id()) {
+    dest.set_id(symbol.id());
+  }
+  if (symbol.has_name()) {
+    dest.set_name(symbol.name());
+  }
+  if (symbol.has_scope()) {
+    dest.set_scope(symbol.scope());
+  }
+  if ((columnsUsed & columns(3, 3)) && symbol.has_signature()) {
+    dest.set_signature(symbol.signature());
+  }
+  if ((columnsUsed & columns(4, 4)) && symbol.has_documentation()) {
+    dest.set_documentation(symbol.documentation());
+  }
+  if ((columnsUsed & columns(5, 5)) && symbol.has_return_type()) {
+    dest.set_return_type(symbol.return_type());
+  }
+  if ((columnsUsed & columns(6, 6)) && symbol.has_type()) {
+    dest.set_type(symbol.type());
+  }
+  if ((columnsUsed & columns(7, 11)) && symbol.has_definition()) {
+    *dest.mutable_definition() = symbol.definition();
+  }
+  if ((columnsUsed & columns(12, 16)) && symbol.has_canonical_declaration()) {
+    *dest.mutable_canonical_declaration() = symbol.canonical_declaration();
+  }
+  if ((columnsUsed & columns(17, 28)) && symbol.has_info()) {
+    *dest.mutable_info() = symbol.info();
+  }
+}
+
+// Fields of a Symbol backing the columns in `columnsUsed`, along with the id,
+// name and scope, in the format of `DecodeSymbolReply`
+static uint32_t symbol_fields(sqlite3_uint64 columnsUsed) {
+  uint32_t fields = symbol_field(Symbol::kIdFieldNumber) |
+                    symbol_field(Symbol::kNameFieldNumber) |
+                    symbol_field(Symbol::kScopeFieldNumber);
+  if (columnsUsed & columns(3, 3)) {
+    fields |= symbol_field(Symbol::kSignatureFieldNumber);
+  }
+  if (columnsUsed & columns(4, 4)) {
+    fields |= symbol_field(Symbol::kDocumentationFieldNumber);
+  }
+  if (columnsUsed & columns(5, 5)) {
+    fields |= symbol_field(Symbol::kReturnTypeFieldNumber);
+  }
+  if (columnsUsed & columns(6, 6)) {
+    fields |= symbol_field(Symbol::kTypeFieldNumber);
+  }
+  if (columnsUsed & columns(7, 11)) {
+    fields |= symbol_field(Symbol::kDefinitionFieldNumber);
+  }
+  if (columnsUsed & columns(12, 16)) {
+    fields |= symbol_field(Symbol::kCanonicalDeclarationFieldNumber);
+  }
+  if (columnsUsed & columns(17, 28)) {
+    fields |= symbol_field(Symbol::kInfoFieldNumber);
+  }
+  return fields;
+}
+
+// Stream of the symbols of `source`, which are all stored in the cache as they
+// are read. They are moved there rather than copied, and only the fields the
+// query needs are copied back out for consumers that want their own copy.
+class CachingSymbolStream final : public IResultStream<Symbol> {
+  std::unique_ptr<IResultStream<Symbol>> m_source;
+  SymbolCache &m_cache;
+  sqlite3_uint64 m_columnsUsed;
+  SymbolCache::SymbolPtr m_current;
 
 public:
-  FuzzyFindStream(SymbolIndex::Stub &stub, FuzzyFindRequest &req)
-    : m_replyReader(stub.FuzzyFind(&m_ctx, req)) {}
+  CachingSymbolStream(std::unique_ptr<IResultStream<Symbol>> source,
+                      SymbolCache &cache, sqlite3_uint64 columnsUsed)
+    : m_source(std::move(source)), m_cache(cache),
+      m_columnsUsed(columnsUsed) {}
 
-  virtual const Symbol &Current() override { return m_reply.stream_result(); }
+  const Symbol &Current() override { return *m_current; }
 
-  virtual bool Next() override {
-    return m_replyReader->Read(&m_reply) && m_reply.has_stream_result();
+  bool Next() override {
+    if (!m_source->Next()) {
+      return false;
+    }
+
+    auto symbol = std::make_shared<Symbol>();
+    m_source->MoveCurrent(*symbol);
+    m_current = symbol;
+    m_cache.Insert(std::move(symbol));
+    return true;
   }
+
+  void Cancel() override { m_source->Cancel(); }
+  bool HasMore() override { return m_source->HasMore(); }
+  bool Ok() override { return m_source->Ok(); }
+
+  void MoveCurrent(Symbol &dest) override {
+    copy_used_fields(*m_current, dest, m_columnsUsed);
+  }
+
+  std::shared_ptr<const Symbol> ShareCurrent() override { return m_current; }
 };
 
-class LookupStream final : public IResultStream<Symbol> {
-  grpc::ClientContext m_ctx;
-  std::unique_ptr<grpc::ClientReader<LookupReply>> m_replyReader;
-  LookupReply m_reply;
+// Number of results asked for by the first request of an exact name search,
+// unless the table has a page size
+constexpr uint32_t exact_name_first_page = 64;
+
+// Yields the symbols whose name is exactly `name`. The server only knows how
+// to do fuzzy searches, so its results are filtered here, and the search is
+// repeated with a growing limit for as long as the server reports having more
+// results than it sent.
+//
+// Like PagedStream, it may be cancelled from another thread than the one
+// reading, so `m_stream` is only replaced or cancelled under `m_mutex`.
+class ExactNameStream final : public IResultStream<Symbol> {
+  IndexBackend &m_backend;
+  SymbolCache &m_cache;
+  FuzzyFindRequest m_req;
+  std::string m_name;
+  std::unique_ptr<CachingSymbolStream> m_stream;
+  // Ids of the symbols returned so far, which later requests send again
+  std::unordered_set<std::string> m_seen;
+  std::vector<std::string> m_ids;
+  sqlite3_uint64 m_columnsUsed;
+  RpcCounters &m_counters;
+  std::atomic<bool> m_cancelled{false};
+  std::mutex m_mutex;
 
 public:
-  LookupStream(SymbolIndex::Stub &stub, LookupRequest &req)
-    : m_replyReader(stub.Lookup(&m_ctx, req)) {}
+  ExactNameStream(IndexBackend &backend, SymbolCache &cache,
+                  const FuzzyFindRequest &req, uint32_t firstPage,
+                  sqlite3_uint64 columnsUsed, RpcCounters &counters)
+    : m_backend(backend), m_cache(cache), m_req(req), m_name(req.query()),
+      m_columnsUsed(columnsUsed), m_counters(counters) {
+    m_req.set_limit(firstPage);
+    Search();
+  }
+
+  // Sends `m_req` again, with whatever limit it now has
+  void Search() {
+    auto stream = std::make_unique<CachingSymbolStream>(
+     m_backend.FuzzyFind(m_req, m_counters), m_cache, m_columnsUsed);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_cancelled) {
+      stream->Cancel();
+    }
+    // The previous search is destroyed once the lock is released
+    m_stream.swap(stream);
+  }
 
-  virtual const Symbol &Current() override { return m_reply.stream_result(); }
+  const Symbol &Current() override { return m_stream->Current(); }
+
+  bool Next() override {
+    while (true) {
+      if (m_stream->Next()) {
+        auto &symbol = m_stream->Current();
+        if (symbol.name() == m_name && m_seen.insert(symbol.id()).second) {
+          m_ids.push_back(symbol.id());
+          return true;
+        }
+        continue;
+      }
+
+      if (m_cancelled || !m_stream->HasMore()) {
+        break;
+      }
+      m_req.set_limit(m_req.limit() > UINT32_MAX / 2 ? UINT32_MAX
+                                                     : m_req.limit() * 2);
+      Search();
+    }
 
-  virtual bool Next() override {
-    return m_replyReader->Read(&m_reply) && m_reply.has_stream_result();
+    // Searches restricted to some scopes don't see every symbol of that name,
+    // and neither do those that failed or were cut short
+    if (!m_cancelled && m_req.any_scope() && m_req.scopes_size() == 0 &&
+        m_stream->Ok() && !m_stream->HasMore()) {
+      m_cache.InsertName(m_name, std::move(m_ids));
+      m_ids.clear();
+    }
+    return false;
   }
-};
 
-enum {
-  // No constraints
-  SEARCH_NONE = 0,
-  // Constraint value for `query` in FuzzyFindRequest
-  SEARCH_FUZZYNAME = 1,
-  // Constraint value for `scope` in FuzzyFindRequest
-  SEARCH_SCOPE = 2,
-  // Constraint value for `id` in LookupRequest
-  SEARCH_ID = 4,
-  // Constraint value for `proximity_paths` in FuzzyFindRequest
-  SEARCH_PATH = 8,
-  // The scope constraint is EQ and not LIKE
-  SEARCH_SCOPE_EXACT = 16
+  void Cancel() override {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cancelled = true;
+    m_stream->Cancel();
+  }
+
+  bool Ok() override { return m_stream->Ok(); }
+
+  void MoveCurrent(Symbol &dest) override { m_stream->MoveCurrent(dest); }
+
+  std::shared_ptr<const Symbol> ShareCurrent() override {
+    return m_stream->ShareCurrent();
+  }
 };
 
+static std::string symbol_key(const Symbol &symbol) { return symbol.id(); }
+
+// Names of the columns, in the order of the schema
+static const char *const column_names[] = {
+ "Id",           "Name",
+ "Scope",        "Signature",
+ "Documentation", "ReturnType",
+ "Type",         "DefPath",
+ "DefStartLine", "DefStartCol",
+ "DefEndLine",   "DefEndCol",
+ "DeclPath",     "DeclStartLine",
+ "DeclStartCol", "DeclEndLine",
+ "DeclEndCol",   "Kind",
+ "SubKind",      "Language",
+ "Generic",      "TemplatePartialSpecialization",
+ "TemplateSpecialization", "UnitTest",
+ "IBAnnotated",  "IBOutletCollection",
+ "GKInspectable", "Local",
+ "ProtocolInterface", "IdInt"};
+
+constexpr int num_columns = sizeof(column_names) / sizeof(*column_names);
+
+// Plans are either `Lookup(id=...)`, where the ids are integers if the key is
+// `rowid`, or `FuzzyFind(...)` with any of `name`, `scope` and `path`. The
+// name and scope are exact if compared with `eq`.
+static AccessPath symbols_path(const QueryPlan &plan) {
+  if (plan.call == "Lookup") {
+    return AccessPath::SymbolById;
+  }
+  if (auto name = plan.Find("name")) {
+    return name->op == PlanOp::Eq ? AccessPath::SymbolByName
+                                  : AccessPath::SymbolByFuzzyName;
+  } else if (plan.Find("scope")) {
+    return AccessPath::SymbolByScope;
+  } else if (plan.Find("path")) {
+    return AccessPath::SymbolByPath;
+  }
+  return AccessPath::SymbolScan;
+}
+
+// Column holding the id as an integer, which is also the rowid
+constexpr int id_int_column = 29;
+
 struct SymbolProperty {
   enum {
     Generic = 1 << 0,
@@ -71,61 +290,268 @@ struct SymbolProperty {
 };
 
 class SymbolsCursor final : public VirtualTableCursor {
-  SymbolIndex::Stub &m_stub;
+  IndexBackend &m_backend;
+  SymbolCache &m_cache;
+  // Null unless the table reads ahead
+  AsyncEngine *m_engine;
+  const TableOptions &m_options;
+  TableStats &m_stats;
   bool m_eof = false;
   std::unique_ptr<IResultStream<Symbol>> m_stream = nullptr;
+  // Number of rows that SQLite can still consume, or -1 if unbounded
+  sqlite3_int64 m_remaining = -1;
+  ScanRecorder m_scan;
+  QueryPlan m_plan;
+  sqlite3_uint64 m_columnsUsed = ~0ULL;
+  // The current row, once it was handed to SQLite without being copied
+  std::shared_ptr<const Symbol> m_shared;
+
+  // Kept across calls to Filter, so that probes by id that are answered by
+  // the cache don't allocate
+  std::vector<std::string> m_ids;
+  LookupRequest m_lookupReq;
+  StreamPool<CachedSymbolStream, Symbol> m_cachedPool;
+
+  const Symbol &CurrentRow() {
+    return m_shared ? *m_shared : m_stream->Current();
+  }
+
+  // Sets the result of `ctx` to the text returned by `get` for the current
+  // row, which is shared with SQLite rather than copied if it is long
+  template <typename Get> void ResultField(sqlite3_context *ctx, Get get) {
+    auto &text = get(CurrentRow());
+    if (!ShouldShare(text)) {
+      ResultText(ctx, text);
+      return;
+    }
+    if (!m_shared) {
+      m_shared = m_stream->ShareCurrent();
+    }
+    ResultText(ctx, get(*m_shared), m_shared);
+  }
 
 public:
-  SymbolsCursor(SymbolIndex::Stub &stub) : m_stub(stub) {}
+  // Looks up in the background the uncached symbols announced right after
+  // `id`, which the next probes are going to ask for
+  void LookupUpcoming(const std::string &id) {
+    LookupRequest req;
+    for (auto &upcoming : m_engine->Upcoming(id, m_options.lookahead)) {
+      if (!m_cache.Find(upcoming) && !m_engine->IsPrefetching(upcoming)) {
+        req.add_ids(upcoming);
+      }
+    }
+    if (req.ids_size() > 0) {
+      m_engine->Prefetch(req, m_stats.Rpc(RpcKind::Lookup));
+    }
+  }
+
+  // Returns the symbols named exactly like the query of `req`, from the cache
+  // if the symbols of that name are known
+  std::unique_ptr<IResultStream<Symbol>>
+  FindExactName(const FuzzyFindRequest &req) {
+    // Proximity paths only affect the order of the results, and the scope is
+    // checked here when it is exact
+    std::vector<SymbolCache::SymbolPtr> symbols;
+    auto &counters = m_stats.Rpc(RpcKind::FuzzyFind);
+    if ((req.scopes_size() == 0 || !req.any_scope()) &&
+        m_cache.FindByName(req.query(), symbols)) {
+      counters.cacheHits.fetch_add(1, std::memory_order_relaxed);
+      if (!req.any_scope()) {
+        symbols.erase(std::remove_if(symbols.begin(), symbols.end(),
+                                     [&](const SymbolCache::SymbolPtr &sym) {
+                                       return sym->scope() != req.scopes(0);
+                                     }),
+                      symbols.end());
+      }
+      return std::make_unique<CachedSymbolStream>(std::move(symbols));
+    }
+
+    counters.cacheMisses.fetch_add(1, std::memory_order_relaxed);
+    return WithPrefetch<Symbol>(
+     std::make_unique<ExactNameStream>(
+      m_backend, m_cache, req,
+      m_options.page_size ? m_options.page_size : exact_name_first_page,
+      m_columnsUsed, counters),
+     m_options.prefetch);
+  }
+
+  // Stores the ids constrained by `value` in `m_ids`, in hex. Integers that
+  // are not ids are left out, since no symbol can match them.
+  void ReadIds(sqlite3_value *value, const PlanArg &arg) {
+    bool isIn = arg.op == PlanOp::In;
+    if (arg.key != "rowid") {
+      TextValues(value, isIn, m_ids);
+      return;
+    }
+
+    m_ids.clear();
+    ForEachValue(value, isIn, [&](sqlite3_value *elem) {
+      if (sqlite3_value_numeric_type(elem) == SQLITE_INTEGER) {
+        m_ids.push_back(FormatSymbolId((uint64_t)sqlite3_value_int64(elem)));
+      }
+    });
+  }
+
+  // Searches by name or scope. Queries that don't use every column are
+  // decoded selectively if the table does so and the backend can, bypassing
+  // the cache.
+  std::unique_ptr<IResultStream<Symbol>>
+  FuzzyFind(const FuzzyFindRequest &req) {
+    auto &counters = m_stats.Rpc(RpcKind::FuzzyFind);
+    if (m_options.selective_decode && m_columnsUsed != ~0ULL) {
+      if (auto stream = m_backend.FuzzyFindFields(
+           req, symbol_fields(m_columnsUsed), counters)) {
+        return stream;
+      }
+    }
+    return std::make_unique<CachingSymbolStream>(
+     m_backend.FuzzyFind(req, counters), m_cache, m_columnsUsed);
+  }
+
+  SymbolsCursor(IndexBackend &backend, SymbolCache &cache,
+                AsyncEngine *engine, const TableOptions &options,
+                TableStats &stats)
+    : m_backend(backend), m_cache(cache), m_engine(engine),
+      m_options(options), m_stats(stats) {}
   int Filter(int idxNum, const char *idxStr, int argc,
              sqlite3_value **argv) override {
-    if (idxNum == SEARCH_ID) {
-      LookupRequest req;
-      req.add_ids((const char *)sqlite3_value_text(argv[0]));
-      m_stream = std::make_unique<LookupStream>(m_stub, req);
+    // Cancel whatever was still running before starting the new call
+    m_shared = nullptr;
+    m_cachedPool.Recycle(m_stream);
+    m_remaining = -1;
+    m_scan.Abandon();
+    if (!m_plan.Parse(idxStr, column_names, num_columns)) {
+      return SQLITE_ERROR;
+    }
+    m_columnsUsed = m_plan.columns;
+    if (m_plan.call == "Lookup") {
+      // Ids that are not cached are all sent in a single request
+      auto cached = m_cachedPool.Take();
+      cached->Reset();
+      m_lookupReq.Clear();
+      ReadIds(argv[0], m_plan.args[0]);
+      m_scan.Start(AccessPath::SymbolById, m_ids.size());
+      if (m_engine && m_ids.size() == 1) {
+        LookupUpcoming(m_ids[0]);
+        // Rather than asking again for a symbol that is on its way
+        m_engine->WaitForSymbol(m_ids[0]);
+      }
+      for (auto &id : m_ids) {
+        if (auto symbol = m_cache.Find(id)) {
+          cached->Add(std::move(symbol));
+        } else {
+          m_lookupReq.add_ids(id);
+        }
+      }
+      auto &counters = m_stats.Rpc(RpcKind::Lookup);
+      counters.cacheHits.fetch_add(m_ids.size() - m_lookupReq.ids_size(),
+                                   std::memory_order_relaxed);
+      counters.cacheMisses.fetch_add(m_lookupReq.ids_size(),
+                                     std::memory_order_relaxed);
+
+      if (m_lookupReq.ids_size() == 0) {
+        m_stream = std::move(cached);
+      } else {
+        auto lookup = std::make_unique<CachingSymbolStream>(
+         m_backend.Lookup(m_lookupReq, counters), m_cache, m_columnsUsed);
+        if (cached->Empty()) {
+          m_cachedPool.Return(std::move(cached));
+          m_stream = std::move(lookup);
+        } else {
+          std::vector<std::unique_ptr<IResultStream<Symbol>>> streams;
+          streams.push_back(std::move(cached));
+          streams.push_back(std::move(lookup));
+          m_stream = std::make_unique<ConcatStream<Symbol>>(std::move(streams));
+        }
+      }
     } else {
       FuzzyFindRequest req;
       req.set_any_scope(true);
       int argIndex = 0;
-
-      bool has_name = idxNum & SEARCH_FUZZYNAME;
-      bool has_scope = idxNum & SEARCH_SCOPE;
-      bool has_path = idxNum & SEARCH_PATH;
-      bool has_exact_scope = idxNum & SEARCH_SCOPE_EXACT;
-
-      if (has_name) {
-        req.set_query((const char *)sqlite3_value_text(argv[argIndex++]));
+      bool has_exact_name = false;
+
+      for (auto &arg : m_plan.args) {
+        auto value = (const char *)sqlite3_value_text(argv[argIndex++]);
+        if (arg.key == "name") {
+          req.set_query(value);
+          has_exact_name = arg.op == PlanOp::Eq;
+        } else if (arg.key == "scope") {
+          req.add_scopes(value);
+          if (arg.op == PlanOp::Eq) {
+            req.set_any_scope(false);
+          }
+        } else if (arg.key == "path") {
+          req.add_proximity_paths(value);
+        }
       }
 
-      if (has_scope) {
-        req.add_scopes((const char *)sqlite3_value_text(argv[argIndex++]));
+      m_remaining = RowLimit(m_plan, argv, argIndex);
+      if (m_remaining == 0) {
+        m_eof = true;
+        return SQLITE_OK;
       }
-
-      if (has_path) {
-        req.add_proximity_paths(
-         (const char *)sqlite3_value_text(argv[argIndex++]));
+      if (m_remaining < 0) {
+        m_scan.Start(symbols_path(m_plan), 1);
       }
-
-      if (has_exact_scope) {
-        req.set_any_scope(false);
+      if (has_exact_name) {
+        m_stream = FindExactName(req);
+      } else {
+        if (m_remaining > 0) {
+          req.set_limit(
+           (uint32_t)std::min<sqlite3_int64>(m_remaining, UINT32_MAX));
+        }
+
+        if (m_options.page_size) {
+          auto maxLimit = SetFirstPage(req, m_options.page_size);
+          m_stream = std::make_unique<PagedStream<FuzzyFindRequest, Symbol>>(
+           req, maxLimit,
+           [this](const FuzzyFindRequest &page) { return FuzzyFind(page); },
+           symbol_key);
+        } else {
+          m_stream = FuzzyFind(req);
+        }
+        m_stream = WithPrefetch(std::move(m_stream), m_options.prefetch);
       }
+    }
 
-      m_stream = std::make_unique<FuzzyFindStream>(m_stub, req);
+    if (m_engine) {
+      m_stream = WithLookahead<Symbol>(
+       std::move(m_stream), *m_engine,
+       [](const Symbol &symbol) -> const std::string & { return symbol.id(); },
+       m_options.lookahead);
     }
     return Next();
   }
   int Next() override {
+    if (m_remaining == 0) {
+      m_eof = true;
+      return SQLITE_OK;
+    }
+
+    m_shared = nullptr;
     m_eof = !m_stream->Next();
+    if (m_eof) {
+      m_scan.Finish();
+    } else {
+      m_scan.Row();
+    }
+    if (!m_eof && m_remaining > 0 && --m_remaining == 0) {
+      // SQLite is not going to ask for more rows than this, so let the server
+      // know it can stop sending them
+      m_stream->Cancel();
+    }
     return SQLITE_OK;
   }
   int Eof() override { return m_eof; }
   int Column(sqlite3_context *ctx, int idxCol) override {
-    auto &Current = m_stream->Current();
+    auto &Current = CurrentRow();
     switch (idxCol) {
 #define SET_RES(field)                                                         \
   do {                                                                         \
     if (Current.has_##field()) {                                               \
-      sqlite3_result_text(ctx, Current.field().c_str(), -1, SQLITE_TRANSIENT); \
+      ResultField(ctx, [](const Symbol &symbol) -> const std::string & {       \
+        return symbol.field();                                                 \
+      });                                                                      \
     } else {                                                                   \
       sqlite3_result_null(ctx);                                                \
     }                                                                          \
@@ -133,8 +559,9 @@ public:
 #define SET_RES2(field1, field2)                                               \
   do {                                                                         \
     if (Current.has_##field1() && Current.field1().has_##field2()) {           \
-      sqlite3_result_text(ctx, Current.field1().field2().c_str(), -1,          \
-                          SQLITE_TRANSIENT);                                   \
+      ResultField(ctx, [](const Symbol &symbol) -> const std::string & {       \
+        return symbol.field1().field2();                                       \
+      });                                                                      \
     } else {                                                                   \
       sqlite3_result_null(ctx);                                                \
     }                                                                          \
@@ -235,26 +662,32 @@ public:
       SET_RES_PROP(TemplateSpecialization);
       break;
     case 23:
-      SET_RES_PROP(TemplateSpecialization);
-      break;
-    case 24:
       SET_RES_PROP(UnitTest);
       break;
-    case 25:
+    case 24:
       SET_RES_PROP(IBAnnotated);
       break;
-    case 26:
+    case 25:
       SET_RES_PROP(IBOutletCollection);
       break;
-    case 27:
+    case 26:
       SET_RES_PROP(GKInspectable);
       break;
-    case 28:
+    case 27:
       SET_RES_PROP(Local);
       break;
-    case 29:
+    case 28:
       SET_RES_PROP(ProtocolInterface);
       break;
+    case id_int_column: {
+      uint64_t id;
+      if (ParseSymbolId(Current.id(), id)) {
+        sqlite3_result_int64(ctx, (sqlite3_int64)id);
+      } else {
+        sqlite3_result_null(ctx);
+      }
+      break;
+    }
 #undef SET_RES
 #undef SET_RES2
 #undef SET_RES3
@@ -262,14 +695,11 @@ public:
     return SQLITE_OK;
   }
   sqlite3_int64 RowId() override {
-    auto res = strtoll(m_stream->Current().id().c_str(), nullptr, 16);
-
-    errno = 0;
-    if (errno) {
-      throw std::exception();
+    uint64_t id;
+    if (!ParseSymbolId(CurrentRow().id(), id)) {
+      throw std::runtime_error("Invalid symbol id");
     }
-
-    return res;
+    return (sqlite3_int64)id;
   }
 };
 
@@ -282,33 +712,46 @@ constexpr const char *schema = R"cpp(
     Kind INT, SubKind INT, Language INT,
     Generic INT, TemplatePartialSpecialization INT, TemplateSpecialization INT,
     UnitTest INT, IBAnnotated INT, IBOutletCollection INT, GKInspectable INT,
-    Local INT, ProtocolInterface INT)
+    Local INT, ProtocolInterface INT, IdInt INTEGER)
   )cpp";
 
-SymbolsTable::SymbolsTable(sqlite3 *db, std::unique_ptr<SymbolIndex::Stub> stub)
-  : m_stub(std::move(stub)) {
+SymbolsTable::SymbolsTable(sqlite3 *db, std::shared_ptr<IndexBackend> backend,
+                           std::shared_ptr<SymbolCache> cache,
+                           std::shared_ptr<AsyncEngine> engine,
+                           const TableOptions &options,
+                           std::shared_ptr<TableStats> stats)
+  : m_backend(std::move(backend)), m_cache(std::move(cache)),
+    m_engine(std::move(engine)), m_options(options),
+    m_stats(std::move(stats)) {
   int err = sqlite3_declare_vtab(db, schema);
   if (err != SQLITE_OK)
     throw std::exception();
 }
 
 int SymbolsTable::BestIndex(sqlite3_index_info *info) {
+  QueryPlan plan;
+
   // First check if we have a search by id
   for (int i = 0; i < info->nConstraint; i++) {
     auto constraint = info->aConstraint[i];
     if (!constraint.usable)
       continue;
-    if (constraint.iColumn == 0 &&
+    bool isInt = constraint.iColumn == -1 || constraint.iColumn == id_int_column;
+    if ((constraint.iColumn == 0 || isInt) &&
         constraint.op == SQLITE_INDEX_CONSTRAINT_EQ) {
       info->aConstraintUsage[i].argvIndex = 1;
       info->aConstraintUsage[i].omit = 1;
-      info->idxNum = SEARCH_ID;
-      info->estimatedCost = 1;
+      bool isIn = CanProcessInAllAtOnce() && sqlite3_vtab_in(info, i, 1);
+      plan.call = "Lookup";
+      plan.Add(isInt ? "rowid" : "id", isIn ? PlanOp::In : PlanOp::Eq);
+      SetEstimates(info, AccessPath::SymbolById, !isIn);
+      SetPlan(info, plan, column_names, num_columns);
       return SQLITE_OK;
     }
   }
 
   int argvIndex = 0;
+  plan.call = "FuzzyFind";
 
   // Look for a search by name
   for (int i = 0; i < info->nConstraint; i++) {
@@ -319,10 +762,11 @@ int SymbolsTable::BestIndex(sqlite3_index_info *info) {
         (constraint.op == SQLITE_INDEX_CONSTRAINT_EQ ||
          constraint.op == SQLITE_INDEX_CONSTRAINT_LIKE)) {
       info->aConstraintUsage[i].argvIndex = ++argvIndex;
-      info->aConstraintUsage[i].omit =
-       constraint.op == SQLITE_INDEX_CONSTRAINT_LIKE;
-      info->idxNum |= SEARCH_FUZZYNAME;
-      info->estimatedCost = 1;
+      // Exact names are checked by the cursor
+      info->aConstraintUsage[i].omit = 1;
+      plan.Add("name", constraint.op == SQLITE_INDEX_CONSTRAINT_EQ
+                        ? PlanOp::Eq
+                        : PlanOp::Like);
       break;
     }
   }
@@ -338,11 +782,9 @@ int SymbolsTable::BestIndex(sqlite3_index_info *info) {
       info->aConstraintUsage[i].argvIndex = ++argvIndex;
       info->aConstraintUsage[i].omit =
        constraint.op == SQLITE_INDEX_CONSTRAINT_LIKE;
-      info->idxNum |= SEARCH_SCOPE;
-      if (constraint.op == SQLITE_INDEX_CONSTRAINT_EQ) {
-        info->idxNum |= SEARCH_SCOPE_EXACT;
-      }
-      info->estimatedCost = 1;
+      plan.Add("scope", constraint.op == SQLITE_INDEX_CONSTRAINT_EQ
+                         ? PlanOp::Eq
+                         : PlanOp::Like);
       break;
     }
   }
@@ -356,17 +798,21 @@ int SymbolsTable::BestIndex(sqlite3_index_info *info) {
         constraint.op == SQLITE_INDEX_CONSTRAINT_LIKE) {
       info->aConstraintUsage[i].argvIndex = ++argvIndex;
       info->aConstraintUsage[i].omit = 1;
-      info->idxNum |= SEARCH_PATH;
-      info->estimatedCost = 1;
+      plan.Add("path", PlanOp::Like);
       break;
     }
   }
 
+  SetEstimates(info, symbols_path(plan), false);
+  UseLimitOffset(info, argvIndex, plan);
+  SetPlan(info, plan, column_names, num_columns);
+
   return SQLITE_OK;
 }
 
 std::unique_ptr<VirtualTableCursor> SymbolsTable::Open() {
-  return std::make_unique<SymbolsCursor>(*m_stub);
+  return std::make_unique<SymbolsCursor>(*m_backend, *m_cache, m_engine.get(),
+                                         m_options, *m_stats);
 }
 
 static void dummy_func(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
@@ -1,16 +1,25 @@
 #ifndef SYMBOLSTABLE_HPP
 #define SYMBOLSTABLE_HPP
-#include "Service.grpc.pb.h"
+#include "AsyncEngine.hpp"
+#include "IndexBackend.hpp"
+#include "Statistics.hpp"
+#include "SymbolCache.hpp"
+#include "TableOptions.hpp"
 #include "VirtualTable.hpp"
 #include "sqlite3ext.h"
 
 class SymbolsTable : public VirtualTable {
-  std::unique_ptr<clang::clangd::remote::v1::SymbolIndex::Stub> m_stub;
+  std::shared_ptr<IndexBackend> m_backend;
+  std::shared_ptr<SymbolCache> m_cache;
+  std::shared_ptr<AsyncEngine> m_engine;
+  TableOptions m_options;
+  std::shared_ptr<TableStats> m_stats;
 
 public:
-  SymbolsTable(
-   sqlite3 *db,
-   std::unique_ptr<clang::clangd::remote::v1::SymbolIndex::Stub> stub);
+  SymbolsTable(sqlite3 *db, std::shared_ptr<IndexBackend> backend,
+               std::shared_ptr<SymbolCache> cache,
+               std::shared_ptr<AsyncEngine> engine, const TableOptions &options,
+               std::shared_ptr<TableStats> stats);
 
   virtual int BestIndex(sqlite3_index_info *info) override;
   virtual std::unique_ptr<VirtualTableCursor> Open() override;
@@ -0,0 +1,41 @@
+#include "TableOptions.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+static size_t parse_size(const std::string &key, const std::string &value) {
+  char *end;
+  auto res = std::strtoull(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0') {
+    throw std::runtime_error("Invalid value `" + value + "' for option `" +
+                             key + "'");
+  }
+  return res;
+}
+
+TableOptions TableOptions::Parse(int argc, const char *const *argv) {
+  TableOptions options;
+  for (int i = 0; i < argc; i++) {
+    auto arg = std::string{argv[i]};
+    auto eq = arg.find('=');
+    if (eq == std::string::npos) {
+      throw std::runtime_error("Invalid option `" + arg + "'");
+    }
+
+    auto key = arg.substr(0, eq);
+    auto value = arg.substr(eq + 1);
+    if (key == "prefetch") {
+      options.prefetch = parse_size(key, value);
+    } else if (key == "lookahead") {
+      options.lookahead = parse_size(key, value);
+    } else if (key == "page_size") {
+      options.page_size = parse_size(key, value);
+    } else if (key == "selective_decode") {
+      options.selective_decode = parse_size(key, value) != 0;
+    } else {
+      throw std::runtime_error("Unknown option `" + key + "'");
+    }
+  }
+  return options;
+}
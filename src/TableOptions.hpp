@@ -0,0 +1,27 @@
+#ifndef TABLEOPTIONS_HPP
+#define TABLEOPTIONS_HPP
+#include <cstddef>
+
+// Options that can follow the connection string when creating a table, in the
+// form `key=value`
+struct TableOptions {
+  // Number of results read ahead by a background thread, 0 to read them only
+  // when SQLite asks for them
+  size_t prefetch = 0;
+  // Number of rows read ahead to let other tables of the same server know
+  // which keys are coming, and number of upcoming keys fetched in the
+  // background when probed with one of them. 0 disables both.
+  size_t lookahead = 0;
+  // Number of results asked for by the first request of a search, which is
+  // then repeated with a growing limit for as long as the server reports
+  // having more. 0 sends a single request and leaves the limit to the server.
+  size_t page_size = 0;
+  // Whether FuzzyFind replies are decoded with only the fields of the symbols
+  // that the query uses. Symbols decoded this way are not cached.
+  bool selective_decode = false;
+
+  // Throws std::runtime_error on unknown keys or invalid values
+  static TableOptions Parse(int argc, const char *const *argv);
+};
+
+#endif
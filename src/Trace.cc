@@ -0,0 +1,185 @@
+#include "Trace.hpp"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+std::atomic<bool> trace_enabled{false};
+
+// Events recorded by a thread past this number are dropped, so that a trace
+// left running doesn't grow without bounds
+constexpr size_t max_events_per_thread = 1 << 20;
+
+struct ThreadBuffer {
+  std::mutex mutex;
+  std::vector<TraceEvent> events;
+  int tid;
+};
+
+static std::mutex buffers_mutex;
+// Buffers of every thread that recorded events, including threads that are
+// gone but whose events weren't written yet
+static std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+static int next_tid = 1;
+// Where the events are written when the trace is stopped
+static std::FILE *trace_file = nullptr;
+
+static std::atomic<int64_t> trace_epoch{0};
+static std::atomic<uint64_t> next_trace_id{1};
+
+static int64_t steady_nanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+   .count();
+}
+
+static ThreadBuffer &thread_buffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+    auto buffer = std::make_shared<ThreadBuffer>();
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffer->tid = next_tid++;
+    buffers.push_back(buffer);
+    return buffer;
+  }();
+  return *buffer;
+}
+
+int64_t TraceNow() {
+  return steady_nanos() - trace_epoch.load(std::memory_order_relaxed);
+}
+
+uint64_t NewTraceId() {
+  return next_trace_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RecordTraceEvent(TraceEvent event) {
+  auto &buffer = thread_buffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  if (buffer.events.size() < max_events_per_thread) {
+    buffer.events.push_back(std::move(event));
+  }
+}
+
+void TraceAsync(char phase, const char *category, const char *name,
+                uint64_t id, std::string args) {
+  if (!TraceEnabled()) {
+    return;
+  }
+  RecordTraceEvent({category, name, phase, TraceNow(), 0, id, std::move(args)});
+}
+
+static std::string json_string(const std::string &text) {
+  std::string res = "\"";
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      res += '\\';
+      res += (char)c;
+    } else if (c < 0x20) {
+      char escape[8];
+      std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+      res += escape;
+    } else {
+      res += (char)c;
+    }
+  }
+  res += "\"";
+  return res;
+}
+
+std::string TraceArg(const char *key, const std::string &value) {
+  return json_string(key) + ":" + json_string(value);
+}
+
+std::string TraceArg(const char *key, int64_t value) {
+  return json_string(key) + ":" + std::to_string(value);
+}
+
+static void write_event(std::FILE *file, const TraceEvent &event, int tid,
+                        bool first) {
+  // Timestamps are in microseconds
+  std::fprintf(file,
+               "%s\n{\"name\":%s,\"cat\":%s,\"ph\":\"%c\",\"ts\":%.3f,"
+               "\"pid\":1,\"tid\":%d",
+               first ? "" : ",", json_string(event.name).c_str(),
+               json_string(event.category).c_str(), event.phase,
+               (double)event.start / 1000, tid);
+  if (event.phase == 'X') {
+    std::fprintf(file, ",\"dur\":%.3f", (double)event.duration / 1000);
+  } else {
+    std::fprintf(file, ",\"id\":\"0x%" PRIx64 "\"", event.id);
+  }
+  std::fprintf(file, ",\"args\":{%s}}", event.args.c_str());
+}
+
+// Takes the events out of every buffer, forgetting the buffers of threads
+// that are gone
+static std::vector<std::pair<int, std::vector<TraceEvent>>> collect_events() {
+  std::vector<std::pair<int, std::vector<TraceEvent>>> res;
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  for (auto &buffer : buffers) {
+    std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+    res.emplace_back(buffer->tid, std::move(buffer->events));
+    buffer->events.clear();
+  }
+
+  std::vector<std::shared_ptr<ThreadBuffer>> alive;
+  for (auto &buffer : buffers) {
+    if (buffer.use_count() > 1) {
+      alive.push_back(std::move(buffer));
+    }
+  }
+  buffers = std::move(alive);
+  return res;
+}
+
+bool StartTrace(const std::string &path) {
+  StopTrace();
+
+  auto file = std::fopen(path.c_str(), "w");
+  if (!file) {
+    return false;
+  }
+
+  collect_events();
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    trace_file = file;
+  }
+  trace_epoch = steady_nanos();
+  trace_enabled = true;
+  return true;
+}
+
+int64_t StopTrace() {
+  if (!trace_enabled.exchange(false)) {
+    return 0;
+  }
+
+  auto events = collect_events();
+  std::FILE *file;
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    file = trace_file;
+    trace_file = nullptr;
+  }
+
+  int64_t count = 0;
+  std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  for (auto &thread : events) {
+    for (auto &event : thread.second) {
+      write_event(file, event, thread.first, count == 0);
+      count++;
+    }
+  }
+  std::fprintf(file, "\n]}\n");
+
+  bool failed = std::ferror(file);
+  if (std::fclose(file) != 0 || failed) {
+    return -1;
+  }
+  return count;
+}
@@ -0,0 +1,98 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Records what the extension spends its time on, for viewing in
+// chrome://tracing or Perfetto. Tracing is off unless started with
+// `StartTrace`, in which case events are appended to a buffer owned by the
+// thread recording them, whose lock is only ever contended while the trace is
+// being written out.
+
+struct TraceEvent {
+  const char *category;
+  const char *name;
+  // 'X' for a span, or 'b', 'n' and 'e' for the steps of an operation that
+  // may start and end on different threads
+  char phase;
+  // Nanoseconds since the trace was started
+  int64_t start;
+  int64_t duration;
+  // Identifies the operation of 'b', 'n' and 'e' events
+  uint64_t id;
+  // Members of the `args` object, already formatted by `TraceArg`
+  std::string args;
+};
+
+extern std::atomic<bool> trace_enabled;
+
+inline bool TraceEnabled() {
+  return trace_enabled.load(std::memory_order_relaxed);
+}
+
+// Starts recording events, to be written to `path` by `StopTrace`. A trace
+// that was still running is written out first. Returns false if `path` can't
+// be written to.
+bool StartTrace(const std::string &path);
+
+// Stops recording and writes the events recorded so far in the Chrome trace
+// event format. Returns the number of events written, which is 0 if no trace
+// was running, or -1 if the file could not be written.
+int64_t StopTrace();
+
+int64_t TraceNow();
+uint64_t NewTraceId();
+
+// Records `event` in the buffer of the calling thread
+void RecordTraceEvent(TraceEvent event);
+
+// Records one step of an operation identified by `id`, such as an RPC
+void TraceAsync(char phase, const char *category, const char *name,
+                uint64_t id, std::string args = {});
+
+// Formats `key` and `value` as a member of the args of an event. Members are
+// separated by commas.
+std::string TraceArg(const char *key, const std::string &value);
+std::string TraceArg(const char *key, int64_t value);
+
+// Records the time between its construction and its destruction as a span,
+// if tracing was on when it was constructed
+class TraceSpan {
+  TraceEvent m_event;
+  bool m_active;
+
+public:
+  TraceSpan(const char *category, const char *name)
+    : m_active(TraceEnabled()) {
+    if (m_active) {
+      m_event.category = category;
+      m_event.name = name;
+      m_event.phase = 'X';
+      m_event.id = 0;
+      m_event.start = TraceNow();
+    }
+  }
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+  ~TraceSpan() {
+    if (m_active) {
+      m_event.duration = TraceNow() - m_event.start;
+      RecordTraceEvent(std::move(m_event));
+    }
+  }
+
+  // Whether the span is recorded, and is worth adding arguments to
+  bool Active() const { return m_active; }
+
+  void AddArg(const std::string &arg) {
+    if (!m_event.args.empty()) {
+      m_event.args += ",";
+    }
+    m_event.args += arg;
+  }
+};
+
+#endif
@@ -1,8 +1,55 @@
 #include "VirtualTable.hpp"
+SQLITE_EXTENSION_INIT3
 
 int VirtualTable::FindFunction(int nArg, const std::string &name,
                                void (**pxFunc)(sqlite3_context *, int,
                                                sqlite3_value **),
                                void **ppArg) {
   return 0;
-}
\ No newline at end of file
+}
+
+bool VirtualTable::CanProcessInAllAtOnce() {
+  return sqlite3_libversion_number() >= 3038000;
+}
+
+void VirtualTable::UseLimitOffset(sqlite3_index_info *info, int &argvIndex,
+                                  QueryPlan &plan) {
+  if (!CanProcessInAllAtOnce()) {
+    return;
+  }
+
+  for (int i = 0; i < info->nConstraint; i++) {
+    auto &constraint = info->aConstraint[i];
+    if (constraint.op == SQLITE_INDEX_CONSTRAINT_LIMIT ||
+        constraint.op == SQLITE_INDEX_CONSTRAINT_OFFSET) {
+      continue;
+    }
+    if (!constraint.usable || !info->aConstraintUsage[i].omit) {
+      return;
+    }
+  }
+
+  for (int i = 0; i < info->nConstraint; i++) {
+    auto &constraint = info->aConstraint[i];
+    if (!constraint.usable) {
+      continue;
+    }
+    if (constraint.op == SQLITE_INDEX_CONSTRAINT_LIMIT) {
+      info->aConstraintUsage[i].argvIndex = ++argvIndex;
+      plan.limit = true;
+    } else if (constraint.op == SQLITE_INDEX_CONSTRAINT_OFFSET) {
+      info->aConstraintUsage[i].argvIndex = ++argvIndex;
+      plan.offset = true;
+    }
+  }
+}
+
+void VirtualTable::SetPlan(sqlite3_index_info *info, QueryPlan &plan,
+                           const char *const *columnNames, int numColumns) {
+  if (columnNames) {
+    plan.columns = info->colUsed;
+  }
+  info->idxStr =
+   sqlite3_mprintf("%s", plan.Format(columnNames, numColumns).c_str());
+  info->needToFreeIdxStr = 1;
+}
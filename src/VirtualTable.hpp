@@ -1,5 +1,6 @@
 #ifndef VIRTUALTABLE_HPP
 #define VIRTUALTABLE_HPP
+#include "QueryPlan.hpp"
 #include "sqlite3ext.h"
 #include <functional>
 #include <memory>
@@ -16,6 +17,25 @@ public:
                            void (**pxFunc)(sqlite3_context *, int,
                                            sqlite3_value **),
                            void **ppArg);
+
+protected:
+  // Whether the running SQLite can hand us all the values of an IN operator
+  // at once, which was introduced in 3.38.0
+  static bool CanProcessInAllAtOnce();
+
+  // Asks SQLite to pass the LIMIT and OFFSET of the query as the last
+  // arguments of xFilter, adding them to `plan`. This is only done when every
+  // other usable constraint has been consumed and omitted, since any further
+  // filtering by SQLite would make the rows fetched from the server
+  // insufficient.
+  static void UseLimitOffset(sqlite3_index_info *info, int &argvIndex,
+                             QueryPlan &plan);
+
+  // Passes `plan` to xFilter in idxStr. If the names of the columns are
+  // given, the columns used by the query are recorded in the plan.
+  static void SetPlan(sqlite3_index_info *info, QueryPlan &plan,
+                      const char *const *columnNames = nullptr,
+                      int numColumns = 0);
 };
 
 #endif
\ No newline at end of file
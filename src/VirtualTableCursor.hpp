@@ -1,6 +1,12 @@
 #ifndef VIRTUALTABLEMONITOR_HPP
 #define VIRTUALTABLEMONITOR_HPP
+#include "QueryPlan.hpp"
 #include "sqlite3ext.h"
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 class VirtualTableCursor {
 public:
@@ -11,6 +17,36 @@ public:
   virtual int Eof() = 0;
   virtual int Column(sqlite3_context *ctx, int idxCol) = 0;
   virtual sqlite3_int64 RowId() = 0;
+
+protected:
+  // Calls `fn` with each value of a constraint argument. If `isIn` is set,
+  // the argument comes from an IN operator that is processed all at once.
+  static void ForEachValue(sqlite3_value *value, bool isIn,
+                           const std::function<void(sqlite3_value *)> &fn);
+
+  // Stores the text values of a constraint argument in `values`, reusing the
+  // storage of the strings already there. If `isIn` is set, the argument
+  // comes from an IN operator that is processed all at once.
+  static void TextValues(sqlite3_value *value, bool isIn,
+                         std::vector<std::string> &values);
+
+  // Reads the arguments set up by `VirtualTable::UseLimitOffset`, returning
+  // the number of rows that SQLite will consume at most, or -1 if unbounded
+  static sqlite3_int64 RowLimit(const QueryPlan &plan, sqlite3_value **argv,
+                                int &argIndex);
+
+  // Whether `text` is long enough to be worth handing to SQLite without a
+  // copy. Shorter strings cost less to copy than to keep track of.
+  static bool ShouldShare(const std::string &text);
+
+  // Sets the result of `ctx` to a copy of `text`
+  static void ResultText(sqlite3_context *ctx, const std::string &text);
+
+  // Sets the result of `ctx` to `text` without copying it. `owner` is kept
+  // alive until SQLite is done with the value, which can be after the cursor
+  // has moved on, e.g. in the accumulator of max().
+  static void ResultText(sqlite3_context *ctx, const std::string &text,
+                         std::shared_ptr<const void> owner);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "WireSymbolStream.hpp"
+#include "Trace.hpp"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <grpcpp/support/proto_buffer_reader.h>
+
+using namespace clang::clangd::remote;
+using google::protobuf::MessageLite;
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::internal::WireFormatLite;
+
+WireStub::WireStub(std::shared_ptr<grpc::ChannelInterface> channel)
+  : m_channel(std::move(channel)),
+    m_fuzzyFind("/clang.clangd.remote.v1.SymbolIndex/FuzzyFind",
+                grpc::internal::RpcMethod::SERVER_STREAMING, m_channel) {}
+
+std::unique_ptr<grpc::ClientReader<grpc::ByteBuffer>>
+WireStub::FuzzyFind(grpc::ClientContext *ctx, const FuzzyFindRequest &req) {
+  return std::unique_ptr<grpc::ClientReader<grpc::ByteBuffer>>(
+   grpc::internal::ClientReaderFactory<grpc::ByteBuffer>::Create(
+    m_channel.get(), m_fuzzyFind, ctx, req));
+}
+
+static bool is_length_delimited(uint32_t tag) {
+  return WireFormatLite::GetTagWireType(tag) ==
+         WireFormatLite::WIRETYPE_LENGTH_DELIMITED;
+}
+
+// Merges the length-delimited message at the current position into `msg`
+static bool read_message(CodedInputStream &in, MessageLite &msg) {
+  uint32_t length;
+  if (!in.ReadVarint32(&length)) {
+    return false;
+  }
+  auto limit = in.PushLimit(length);
+  bool ok = msg.MergePartialFromCodedStream(&in) && in.ConsumedEntireMessage();
+  in.PopLimit(limit);
+  return ok;
+}
+
+// Reads the fields of a Symbol up to the current limit
+static bool read_symbol(CodedInputStream &in, uint32_t fields, Symbol &symbol) {
+  while (auto tag = in.ReadTag()) {
+    auto number = WireFormatLite::GetTagFieldNumber(tag);
+    if (number >= 32 || !(fields & symbol_field(number)) ||
+        !is_length_delimited(tag)) {
+      // Numeric fields are not needed by any column
+      if (!WireFormatLite::SkipField(&in, tag)) {
+        return false;
+      }
+      continue;
+    }
+
+    bool ok = true;
+    switch (number) {
+    case Symbol::kIdFieldNumber:
+      ok = WireFormatLite::ReadString(&in, symbol.mutable_id());
+      break;
+    case Symbol::kInfoFieldNumber:
+      ok = read_message(in, *symbol.mutable_info());
+      break;
+    case Symbol::kNameFieldNumber:
+      ok = WireFormatLite::ReadString(&in, symbol.mutable_name());
+      break;
+    case Symbol::kDefinitionFieldNumber:
+      ok = read_message(in, *symbol.mutable_definition());
+      break;
+    case Symbol::kScopeFieldNumber:
+      ok = WireFormatLite::ReadString(&in, symbol.mutable_scope());
+      break;
+    case Symbol::kCanonicalDeclarationFieldNumber:
+      ok = read_message(in, *symbol.mutable_canonical_declaration());
+      break;
+    case Symbol::kSignatureFieldNumber:
+      ok = WireFormatLite::ReadString(&in, symbol.mutable_signature());
+      break;
+    case Symbol::kDocumentationFieldNumber:
+      ok = WireFormatLite::ReadString(&in, symbol.mutable_documentation());
+      break;
+    case Symbol::kReturnTypeFieldNumber:
+      ok = WireFormatLite::ReadString(&in, symbol.mutable_return_type());
+      break;
+    case Symbol::kTypeFieldNumber:
+      ok = WireFormatLite::ReadString(&in, symbol.mutable_type());
+      break;
+    default:
+      ok = WireFormatLite::SkipField(&in, tag);
+      break;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return in.ConsumedEntireMessage();
+}
+
+bool DecodeSymbolReply(grpc::ByteBuffer &buffer, uint32_t fields,
+                       Symbol &symbol, bool &isFinal, bool &hasMore) {
+  grpc::ProtoBufferReader reader(&buffer);
+  CodedInputStream in(&reader);
+
+  symbol.Clear();
+  isFinal = false;
+  while (auto tag = in.ReadTag()) {
+    auto number = WireFormatLite::GetTagFieldNumber(tag);
+    if (number == FuzzyFindReply::kStreamResultFieldNumber &&
+        is_length_delimited(tag)) {
+      uint32_t length;
+      if (!in.ReadVarint32(&length)) {
+        return false;
+      }
+      auto limit = in.PushLimit(length);
+      bool ok = read_symbol(in, fields, symbol);
+      in.PopLimit(limit);
+      if (!ok) {
+        return false;
+      }
+      isFinal = false;
+    } else if (number == FuzzyFindReply::kFinalResultFieldNumber &&
+               is_length_delimited(tag)) {
+      FinalResult result;
+      if (!read_message(in, result)) {
+        return false;
+      }
+      isFinal = true;
+      hasMore = result.has_more();
+    } else if (!WireFormatLite::SkipField(&in, tag)) {
+      return false;
+    }
+  }
+  return in.ConsumedEntireMessage();
+}
+
+WireSymbolStream::WireSymbolStream(WireStub &stub, const FuzzyFindRequest &req,
+                                   uint32_t fields, RpcCounters &counters)
+  : m_fields(fields), m_recorder(counters) {
+  m_replyReader = stub.FuzzyFind(&m_ctx, req);
+}
+
+WireSymbolStream::~WireSymbolStream() {
+  if (!m_done) {
+    m_ctx.TryCancel();
+
+    auto &counters = m_recorder.Counters();
+    counters.cancelled++;
+    while (m_replyReader->Read(&m_buffer)) {
+      counters.discardedMessages++;
+      counters.discardedBytes += m_buffer.Length();
+    }
+  }
+  auto status = m_replyReader->Finish();
+  m_recorder.Finish(status.ok(),
+                    status.error_code() == grpc::StatusCode::CANCELLED);
+}
+
+bool WireSymbolStream::Next() {
+  if (m_done) {
+    return false;
+  }
+
+  bool gotReply;
+  {
+    // Only receiving, since replies are decoded separately
+    TraceSpan span("rpc", "read");
+    gotReply = m_replyReader->Read(&m_buffer);
+  }
+  if (gotReply) {
+    m_recorder.Message(m_buffer.Length());
+    bool isFinal;
+    bool decoded;
+    {
+      TraceSpan span("rpc", "decode");
+      decoded = DecodeSymbolReply(m_buffer, m_fields, m_current, isFinal,
+                                  m_hasMore);
+    }
+    if (!decoded) {
+      // Results can't be trusted past a reply that makes no sense
+      m_recorder.Error();
+      m_ctx.TryCancel();
+      return false;
+    }
+    if (!isFinal) {
+      return true;
+    }
+
+    // The final result is the last message, so the server is done
+    m_ok = true;
+    m_done = !m_replyReader->Read(&m_buffer);
+  } else {
+    m_done = true;
+  }
+  if (m_done) {
+    m_recorder.Done();
+  }
+  return false;
+}
@@ -0,0 +1,70 @@
+#ifndef WIRESYMBOLSTREAM_HPP
+#define WIRESYMBOLSTREAM_HPP
+#include "IResultStream.hpp"
+#include "Service.grpc.pb.h"
+#include "Statistics.hpp"
+#include <grpcpp/grpcpp.h>
+
+#include <cstdint>
+#include <memory>
+
+// Calls the SymbolIndex service, handing over replies as they came over the
+// wire instead of parsing them into messages
+class WireStub {
+  std::shared_ptr<grpc::ChannelInterface> m_channel;
+  grpc::internal::RpcMethod m_fuzzyFind;
+
+public:
+  explicit WireStub(std::shared_ptr<grpc::ChannelInterface> channel);
+
+  std::unique_ptr<grpc::ClientReader<grpc::ByteBuffer>>
+  FuzzyFind(grpc::ClientContext *ctx,
+            const clang::clangd::remote::FuzzyFindRequest &req);
+};
+
+// Field numbers of `Symbol`, in the format expected by `DecodeSymbolReply`
+constexpr uint32_t symbol_field(int number) { return 1u << number; }
+
+// Decodes a FuzzyFindReply or LookupReply, only parsing the fields of the
+// symbol that are in `fields` and skipping over the others. Sets `isFinal`
+// and `hasMore` if the reply is the final result. Returns false if the reply
+// is malformed.
+bool DecodeSymbolReply(grpc::ByteBuffer &buffer, uint32_t fields,
+                       clang::clangd::remote::Symbol &symbol, bool &isFinal,
+                       bool &hasMore);
+
+// FuzzyFind results that are decoded with only some of their fields. Large
+// fields such as the documentation, the completion snippet or the headers are
+// never parsed unless asked for.
+//
+// Symbols decoded this way are incomplete, so they are not cached.
+class WireSymbolStream final
+  : public IResultStream<clang::clangd::remote::Symbol> {
+  uint32_t m_fields;
+  CallRecorder m_recorder;
+  bool m_done = false;
+  bool m_hasMore = false;
+  bool m_ok = false;
+
+  grpc::ClientContext m_ctx;
+  std::unique_ptr<grpc::ClientReader<grpc::ByteBuffer>> m_replyReader;
+  grpc::ByteBuffer m_buffer;
+  clang::clangd::remote::Symbol m_current;
+
+public:
+  WireSymbolStream(WireStub &stub,
+                   const clang::clangd::remote::FuzzyFindRequest &req,
+                   uint32_t fields, RpcCounters &counters);
+  ~WireSymbolStream() override;
+
+  const clang::clangd::remote::Symbol &Current() override { return m_current; }
+  bool Next() override;
+  void Cancel() override { m_ctx.TryCancel(); }
+  bool HasMore() override { return m_hasMore; }
+  bool Ok() override { return m_ok; }
+  void MoveCurrent(clang::clangd::remote::Symbol &dest) override {
+    dest.Swap(&m_current);
+  }
+};
+
+#endif
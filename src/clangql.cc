@@ -2,6 +2,13 @@
 SQLITE_EXTENSION_INIT1
 
 #include "ClangQLModule.hpp"
+#include "Snapshot.hpp"
+#include "Statistics.hpp"
+#include "StatsModule.hpp"
+#include "Trace.hpp"
+
+#include <cstring>
+#include <exception>
 
 #ifdef _WIN32
 #define EXPORT extern "C" __declspec(dllexport)
@@ -78,6 +85,95 @@ static void symbol_language(sqlite3_context *ctx, int argc,
   }
 }
 
+// clangql_counter(rpc, counter) returns the value of one of the counters kept
+// for an RPC, summed over all tables, e.g. clangql_counter('Refs',
+// 'discarded_bytes')
+static void clangql_counter(sqlite3_context *ctx, int argc,
+                            sqlite3_value **argv) {
+  auto rpc = (const char *)sqlite3_value_text(argv[0]);
+  auto name = (const char *)sqlite3_value_text(argv[1]);
+  if (!rpc || !name) {
+    sqlite3_result_null(ctx);
+    return;
+  }
+
+  for (int i = 0; i < num_rpc_kinds; i++) {
+    if (std::strcmp(rpc, RpcName((RpcKind)i))) {
+      continue;
+    }
+
+    std::atomic<uint64_t> RpcCounters::*counter;
+    if (!std::strcmp(name, "cancelled")) {
+      counter = &RpcCounters::cancelled;
+    } else if (!std::strcmp(name, "discarded_messages")) {
+      counter = &RpcCounters::discardedMessages;
+    } else if (!std::strcmp(name, "discarded_bytes")) {
+      counter = &RpcCounters::discardedBytes;
+    } else {
+      sqlite3_result_error(ctx, "Invalid counter", -1);
+      return;
+    }
+
+    uint64_t sum = 0;
+    ForEachTableStats(
+     [&](TableStats &stats) { sum += stats.Rpc((RpcKind)i).*counter; });
+    sqlite3_result_int64(ctx, (sqlite3_int64)sum);
+    return;
+  }
+  sqlite3_result_error(ctx, "Invalid RPC", -1);
+}
+
+// clangql_trace(path) starts recording a trace of the extension, to be
+// written to `path` in the Chrome trace event format. clangql_trace(NULL)
+// stops it and writes the file, returning the number of events written.
+// Since it writes files, it cannot be called from the views or triggers of a
+// database schema.
+static void clangql_trace(sqlite3_context *ctx, int argc,
+                          sqlite3_value **argv) {
+  auto path = (const char *)sqlite3_value_text(argv[0]);
+  if (!path) {
+    auto count = StopTrace();
+    if (count < 0) {
+      sqlite3_result_error(ctx, "Could not write the trace", -1);
+    } else {
+      sqlite3_result_int64(ctx, count);
+    }
+    return;
+  }
+
+  if (!StartTrace(path)) {
+    sqlite3_result_error(ctx, "Could not open the trace file", -1);
+  } else {
+    sqlite3_result_null(ctx);
+  }
+}
+
+// Number of calls a snapshot crawl makes at a time
+constexpr size_t snapshot_crawl_threads = 16;
+
+// clangql_snapshot(server, path) copies the whole index of `server` to a
+// snapshot at `path`, returning the number of symbols copied. The calls show
+// up in clangql_stats as those of a `clangql_snapshot` table. Like
+// clangql_trace, it is not callable from views or triggers.
+static void clangql_snapshot(sqlite3_context *ctx, int argc,
+                             sqlite3_value **argv) {
+  auto server = (const char *)sqlite3_value_text(argv[0]);
+  auto path = (const char *)sqlite3_value_text(argv[1]);
+  if (!server || !path) {
+    sqlite3_result_null(ctx);
+    return;
+  }
+
+  try {
+    auto stats = GetTableStats("clangql_snapshot", server);
+    auto count = WriteSnapshot(*GetIndexBackend(server), *stats, path,
+                               snapshot_crawl_threads);
+    sqlite3_result_int64(ctx, (sqlite3_int64)count);
+  } catch (const std::exception &e) {
+    sqlite3_result_error(ctx, e.what(), -1);
+  }
+}
+
 #define CHECK_ERR(e)                                                           \
   do {                                                                         \
     if ((rc = (e)) != SQLITE_OK)                                               \
@@ -99,6 +195,21 @@ EXPORT int sqlite3_clangql_init(sqlite3 *db, char **pzErrMsg,
                                     nullptr, symbol_language, nullptr,
                                     nullptr));
 
+  CHECK_ERR(sqlite3_create_function(db, "clangql_counter", 2, SQLITE_UTF8,
+                                    nullptr, clangql_counter, nullptr,
+                                    nullptr));
+
+  CHECK_ERR(sqlite3_create_function(db, "clangql_trace", 1,
+                                    SQLITE_UTF8 | SQLITE_DIRECTONLY, nullptr,
+                                    clangql_trace, nullptr, nullptr));
+
+  CHECK_ERR(sqlite3_create_function(db, "clangql_snapshot", 2,
+                                    SQLITE_UTF8 | SQLITE_DIRECTONLY, nullptr,
+                                    clangql_snapshot, nullptr, nullptr));
+
+  auto stats = new StatsModule();
+  CHECK_ERR(stats->Register(db, "clangql_stats"));
+
   auto mod = new ClangQLModule();
 
   return mod->Register(db, "clangql");